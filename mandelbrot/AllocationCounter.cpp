@@ -0,0 +1,49 @@
+#include "AllocationCounter.h"
+
+#ifdef COUNT_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+static thread_local unsigned long allocations = 0;
+
+unsigned long thread_allocations()
+{
+	return allocations;
+}
+
+void * operator new(std::size_t size)
+{
+	++allocations;
+	void * p = std::malloc(size ? size : 1);
+	if (p == nullptr) { throw std::bad_alloc(); }
+	return p;
+}
+
+void * operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	++allocations;
+	return std::malloc(size ? size : 1);
+}
+
+void * operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete[](void * p) noexcept { std::free(p); }
+void operator delete(void * p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void * p, std::size_t) noexcept { std::free(p); }
+void operator delete(void * p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void * p, const std::nothrow_t&) noexcept { std::free(p); }
+#else
+unsigned long thread_allocations()
+{
+	return 0;
+}
+#endif
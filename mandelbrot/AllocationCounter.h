@@ -0,0 +1,11 @@
+// Allocation counter
+// Debug builds replace the global operator new to count the heap allocations of every thread,
+// so the frame loop can assert that a warmed up frame doesn't allocate. Release builds count nothing.
+#pragma once
+
+#if !defined(NDEBUG)
+#define COUNT_ALLOCATIONS
+#endif
+
+// number of heap allocations the calling thread made so far (always 0 without COUNT_ALLOCATIONS)
+unsigned long thread_allocations();
@@ -0,0 +1,380 @@
+#include "AmpBackend.h"
+#include <codecvt>
+#include <iomanip>
+#include <locale>
+#include "complex.h"
+
+// convert wstring to string
+static std::string ws2s(const std::wstring& wstr)
+{
+	using convert_typeX = std::codecvt_utf8<wchar_t>;
+	std::wstring_convert<convert_typeX, wchar_t> converterX;
+
+	return converterX.to_bytes(wstr);
+}
+
+AmpBackend::AmpBackend(const accelerator& accl) :
+	accl_(accl)
+{
+	description_ = ws2s(accl_.description);
+	// timing file names can't contain spaces, brackets, ...
+	for (char c : description_)
+	{
+		if (isalnum((unsigned char)c)) { name_ += c; }
+		else if (!name_.empty() && name_.back() != '_') { name_ += '_'; }
+	}
+	if (!name_.empty() && name_.back() == '_') { name_.pop_back(); }
+}
+
+BackendCapabilities AmpBackend::capabilities() const
+{
+	// the C++ AMP runtime allocates for every array_view and parallel_for_each
+	return BackendCapabilities{ accl_.supports_double_precision, TILE_SIZE, 0, accl_.is_emulated, false, false };
+}
+
+bool AmpBackend::supports(CALC_MANDELBROT method) const
+{
+	return method == AMP_MANDELBROT || method == AMP_PIXEL_MANDELBROT || method == AMP_BARRIER_MANDELBROT;
+}
+
+void AmpBackend::print_details(std::ostream& out) const
+{
+	if (accl_ == accelerator(accelerator::direct3d_ref))
+		out << " WARNING!! Running on very slow emulator! Only use this accelerator for debugging." << std::endl;
+
+	const char * bs[2] = { "false", "true" };
+	out << ": " << description_ << " "
+		<< endl << "       device_path                       = " << ws2s(accl_.device_path)
+		<< endl << "       dedicated_memory                  = " << std::setprecision(4) << float(accl_.dedicated_memory) / (1024.0f * 1024.0f) << " Mb"
+		<< endl << "       has_display                       = " << bs[accl_.has_display]
+		<< endl << "       is_debug                          = " << bs[accl_.is_debug]
+		<< endl << "       is_emulated                       = " << bs[accl_.is_emulated]
+		<< endl << "       supports_double_precision         = " << bs[accl_.supports_double_precision]
+		<< endl << "       supports_limited_double_precision = " << bs[accl_.supports_limited_double_precision]
+		<< endl << endl;
+}
+
+// a parallel_for_each can't be interrupted, so a cancelled request is only skipped before it starts
+bool AmpBackend::render(const FrameRequest& request, const FrameTarget& target)
+{
+	if (request.cancel.cancelled()) { return false; }
+	switch (request.method)
+	{
+	case AMP_MANDELBROT: amp_mandelbrot(request, target); break;
+	case AMP_PIXEL_MANDELBROT: amp_pixel_mandelbrot(request, target); break;
+	case AMP_BARRIER_MANDELBROT: amp_barrier_mandelbrot(request, target); break;
+	default: break;
+	}
+	return !request.cancel.cancelled();
+}
+
+void AmpBackend::amp_mandelbrot(const FrameRequest& request, const FrameTarget& target)
+{
+	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
+	/// marshaling the this pointer which is not allowed by one of the restrictions. 
+	/// Hence the member variables are copied to local variables and then used inside the kernel.
+	// extent - the extent class specifies the lenght of the data 
+	// in each dimension of the array or array_view object
+	// you can create an extent object and use it to create an array or array_view object
+	// you can also specify	the extent using explicit parameters
+	// in the array or array_view constructor
+	// in this case an extent object is used to 
+	// create a 2D array_view object 
+	// with rows and columns defined 
+	// by the width and height of the frame
+
+	// accelerator to be used with parallel for each
+	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
+	accelerator_view av = accl_.default_view;
+
+	// array view - wraper for the escape counts of the mandelbrot (coloured afterwards by the Palette)
+	extent<2> e(request.width, request.height);
+	array_view<uint32_t, 2> iterations_array_view(e, target.iterations);
+	iterations_array_view.discard_data(); // discarding iterations_array_view data speeds up calculations
+
+	// variables to pass to parallel_for_each lambda function
+	float left = float(request.left);
+	float right = float(request.right);
+	float top = float(request.top);
+	float bottom = float(request.bottom);
+	unsigned max_iter = request.max_iter;
+	float escape_radius = request.escape_radius;
+	int width = request.width;
+	int height = request.height;
+	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
+	// a tile - a group of threads within the thread block
+	// tiling up to 3D
+	try
+	{
+		// kernel - code that's embeded in parallel_for_each function   
+		parallel_for_each(
+			av,                                                   // what accelerator to use
+			iterations_array_view.extent.tile<TILE_SIZE, TILE_SIZE>().pad(), // times kernel is to tun - compute domain (padded to whole tiles)
+			[=]                                                   // pass data to computation tho' capture clause by value [=]
+			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx)             // index to access elem. of array_view
+			mutable                                               // mutable allows copies to be modified, but not originals
+			restrict(amp)                                         // subset of the C++ language that C++ AMP can accelerate is used
+		{                                                                     
+			// index - represents a unique point in N-dimensional space. 
+			// The index Class specifies a location in the array or array_view object 
+			// (by encapsulating the offset from the origin in each dimension into one object)
+			// the first parameter in the index constructor gives row number,
+			// and the second parameter gives column (within row) for 2D
+			index<2> idx = t_idx.global; // changes for tiled index - (latency hiding?)
+
+			// Work out the point in the complex plane that
+			// corresponds to this pixel in the output image.
+
+			Complex c =
+			{
+				// idx[0] represents row
+				left + (idx[0] * (right - left) / width),
+				// idx[1] represents column
+				top + (idx[1] * (bottom - top) / height)
+			};
+
+			// Iterate z = z^2 + c until z moves further than the escape radius
+			// away from (0, 0), or we've iterated too many times (skipping points known to be in the set).
+			unsigned iterations = c_escape_time(c, max_iter, escape_radius);
+			// iterations == max_iter - z didn't escape from the circle, this point is in the Mandelbrot set.
+			// The colours are set by the Palette once the counts are back on the CPU.
+			// threads of the padding outside the frame don't write anything
+			if (idx[0] < width && idx[1] < height)
+				iterations_array_view[idx] = iterations;
+		});
+		// Implicit Synchronisation - No potential interactions amongst threads therefore none is needed
+		iterations_array_view.synchronize(); // copy data back to CPU
+	}
+	catch (const Concurrency::runtime_exception& ex)
+	{
+		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+	}
+}
+
+// No potential interactions amongst threads therefore none is needed
+void AmpBackend::amp_pixel_mandelbrot(const FrameRequest& request, const FrameTarget& target)
+{
+	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
+	/// marshaling the this pointer which is not allowed by one of the restrictions. 
+	/// Hence the member variables are copied to local variables and then used inside the kernel.
+	// extent - the extent class specifies the lenght of the data 
+	// in each dimension of the array or array_view object
+	// you can create an extent object and use it to create an array or array_view object
+	// you can also specify	the extent using explicit parameters
+	// in the array or array_view constructor
+	// in this case an extent object is used to 
+	// create a 2D array_view object 
+	// with rows and columns defined 
+	// by the width and height of the frame
+
+	// accelerator to be used with parallel for each
+	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
+	accelerator_view av = accl_.default_view;
+
+	// array view - wraper for the texels uploaded to the texture (row y, column x)
+	extent<2> texel_array_view_e(request.height, request.width);
+	array_view<uint32_t, 2> texel_array_view(texel_array_view_e, target.texels);
+	texel_array_view.discard_data();
+
+	float left = float(request.left);
+	float right = float(request.right);
+	float top = float(request.top);
+	float bottom = float(request.bottom);
+	unsigned max_iter = request.max_iter;
+	float escape_radius = request.escape_radius;
+	int width = request.width;
+	int height = request.height;
+	unsigned r = request.r;
+	unsigned g = request.g;
+	unsigned b = request.b;
+	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
+	// a tile - a group of threads within the thread block
+	// tiling up to 3D
+	try
+	{
+		// kernel - code that's embeded in parallel_for_each function
+		parallel_for_each(
+			av,                                                      // what accelerator to use
+			extent<2>(width, height).tile<TILE_SIZE, TILE_SIZE>().pad(), // times kernel is to tun - compute domain (padded to whole tiles)
+			[=]														 // pass data to computation tho' capture clause by value [=]
+			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx) 				 // index to access elem. of array_view
+			mutable 												 // mutable allows copies to be modified, but not originals
+			restrict(amp) 											 // subset of the C++ language that C++ AMP can accelerate is used
+		{
+			// index - represents a unique point in N-dimensional space. 
+			// The index Class specifies a location in the array or array_view object 
+			// (by encapsulating the offset from the origin in each dimension into one object)
+			// the first parameter in the index constructor gives row number,
+			// and the second parameter gives column (within row) for 2D
+			index<2> idx = t_idx.global; // changes for tiled index - (latency hiding?)
+
+			// tile_static int t[WIDTH][HEIGHT];
+			// Work out the point in the complex plane that
+			// corresponds to this pixel in the output image.
+			Complex c =
+			{
+				// idx[0] represents rows
+				left + (idx[0] * (right - left) / width),
+				// idx[1] represents columns
+				top + (idx[1] * (bottom - top) / height)
+			};
+
+			// Iterate z = z^2 + c until z moves further than the escape radius
+			// away from (0, 0), or we've iterated too many times (skipping points known to be in the set).
+			unsigned iterations = c_escape_time(c, max_iter, escape_radius);
+			// set colours
+			if (iterations == max_iter)
+			{
+				// z didn't escape from the circle.
+				// This point is in the Mandelbrot set.
+				r = iterations * iterations * iterations * r;
+				g = iterations * iterations * iterations * g;
+				b = iterations * iterations * iterations * b;
+			}
+			else
+			{
+				// z escaped within less than MAX_ITERATIONS
+				// iterations. This point isn't in the set.
+				r = iterations * iterations * iterations * iterations * iterations* r;
+				g = iterations * iterations * iterations * iterations * iterations* g;
+				b = iterations * iterations * iterations * iterations * iterations* b;
+			}
+			// one packed BGRA texel per pixel, written once (not for the padding outside the frame)
+			if (idx[0] < width && idx[1] < height)
+				texel_array_view(idx[1], idx[0]) = 0xFF000000 | ((r & 0xFF) << 16) | ((g & 0xFF) << 8) | (b & 0xFF);
+		});
+		// Implicit Synchronisation - No potential interactions amongst threads therefore none is needed
+		texel_array_view.synchronize(); // copy back data to CPU
+	}
+	catch (const Concurrency::runtime_exception& ex)
+	{
+		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+	}
+}
+
+// Will not work for TILE_SIZE == 32, will work for TILE_SIZE < 32
+// The smaller number of TILE_SIZE the more detailed the image is
+void AmpBackend::amp_barrier_mandelbrot(const FrameRequest& request, const FrameTarget& target)
+{
+	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
+	/// marshaling the this pointer which is not allowed by one of the restrictions. 
+	/// Hence the member variables are copied to local variables and then used inside the kernel.
+	// extent - the extent class specifies the lenght of the data 
+	// in each dimension of the array or array_view object
+	// you can create an extent object and use it to create an array or array_view object
+	// you can also specify	the extent using explicit parameters
+	// in the array or array_view constructor
+	// in this case an extent object is used to 
+	// create a 2D array_view object 
+	// with rows and columns defined 
+	// by the width and height of the frame
+
+	// accelerator to be used with parallel for each
+	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
+	accelerator_view av = accl_.default_view;
+
+	// array view - wraper for the texels uploaded to the texture (row y, column x)
+	extent<2> texel_array_view_e(request.height, request.width);
+	array_view<uint32_t, 2> texel_array_view(texel_array_view_e, target.texels);
+	texel_array_view.discard_data();
+
+	float left = float(request.left);
+	float right = float(request.right);
+	float top = float(request.top);
+	float bottom = float(request.bottom);
+	unsigned max_iter = request.max_iter;
+	float escape_radius = request.escape_radius;
+	int width = request.width;
+	int height = request.height;
+	unsigned r = request.r;
+	unsigned g = request.g;
+	unsigned b = request.b;
+	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
+	// a tile - a group of threads within the thread block
+	// tiling up to 3D
+	try
+	{
+		// kernel - code that's embeded in parallel_for_each function
+		parallel_for_each(
+			av,                                                   // what accelerator to use
+			extent<2>(width, height).tile<TILE_SIZE, TILE_SIZE>().pad(), // times kernel is to tun - compute domain (padded to whole tiles)
+			[=]													  // pass data to computation tho' capture clause by value [=]
+			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx) 			  // index to access elem. of array_view
+			mutable 											  // mutable allows copies to be modified, but not originals
+			restrict(amp)										  // subset of the C++ language that C++ AMP can accelerate is used
+		{
+			// index - represents a unique point in N-dimensional space. 
+			// The index Class specifies a location in the array or array_view object 
+			// (by encapsulating the offset from the origin in each dimension into one object)
+			// the first parameter in the index constructor gives row number,
+			// and the second parameter gives column (within row) for 2D
+			index<2> idx = t_idx; // global index - idx[0] is the column and idx[1] the row of the pixel
+
+			// Work out the point in the complex plane that
+			// corresponds to this pixel in the output image.
+
+			Complex c =
+			{
+				// idx[0] represents row
+				left + (idx[0] * (right - left) / width),
+				// idx[1] represents column
+				top + (idx[1] * (bottom - top) / height)
+			};
+
+			// Iterate z = z^2 + c until z moves further than the escape radius
+			// away from (0, 0), or we've iterated too many times (skipping points known to be in the set).
+			unsigned iterations = c_escape_time(c, max_iter, escape_radius);
+			// set colours
+			if (iterations == max_iter)
+			{
+				// z didn't escape from the circle.
+				// This point is in the Mandelbrot set.
+				// r, g, b values are being modified outside the lambda
+				// and packed directly into the texel
+			}
+			else
+			{
+				// z escaped within less than MAX_ITERATIONS
+				// iterations. This point isn't in the set.
+				r = iterations * iterations * r;
+				g = iterations * iterations * g;
+				b = iterations * iterations * b;
+			}
+			// Copy the texels of the tile into a tile-sized array. 
+			// create a TILE_SIZE x TILE_SIZE array to hold the values in this tile
+			tile_static uint32_t tileValues[TILE_SIZE][TILE_SIZE];
+			// store the texel transposed - x is the first index of the compute domain but the second of the texture
+			tileValues[t_idx.local[1]][t_idx.local[0]] = 0xFF000000 | ((r & 0xFF) << 16) | ((g & 0xFF) << 8) | (b & 0xFF);
+			// when all the threads have exectuted and the TILE_SIZE x TILE_SIZE array is complete, write the tile out
+			t_idx.barrier.wait_with_tile_static_memory_fence();
+
+			// each thread writes one texel, neighbouring threads write neighbouring texels of a texture row
+			// (every thread waits at the barrier, only the ones inside the frame write)
+			index<2> origin = t_idx.tile_origin;
+			int row = origin[1] + t_idx.local[0];
+			int column = origin[0] + t_idx.local[1];
+			if (row < height && column < width)
+				texel_array_view(row, column) = tileValues[t_idx.local[0]][t_idx.local[1]];
+		});
+		texel_array_view.synchronize(); // copy back data to CPU
+	}
+	catch (const accelerator_view_removed & ex)
+	{
+		cout << ex.what() << endl;
+		cout << ex.get_view_removed_reason() << endl;
+	}
+	catch (const Concurrency::runtime_exception& ex)
+	{
+		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+	}
+}
+
+// one backend for every accelerator found by C++ AMP, listed first so keys 1-4 keep selecting them
+static BackendRegistrar amp_backends(0, [](std::vector<std::unique_ptr<Backend>>& backends)
+{
+	std::vector<accelerator> accls = accelerator::get_all();
+	for (const accelerator& accl : accls)
+	{
+		backends.push_back(std::unique_ptr<Backend>(new AmpBackend(accl)));
+	}
+});
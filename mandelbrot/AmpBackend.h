@@ -0,0 +1,34 @@
+// AmpBackend class
+// Runs amp_mandelbrot, amp_pixel_mandelbrot and amp_barrier_mandelbrot on one C++ AMP accelerator.
+// A backend is registered for every accelerator returned by accelerator::get_all().
+#pragma once
+#ifdef _MSC_VER
+#include <amp.h>
+#else
+#include "amp_cpu.h" // CPU emulation of C++ AMP for GCC/Clang
+#endif
+#include "dependencies.h"
+#include "Backend.h"
+
+using namespace concurrency;
+
+class AmpBackend : public Backend
+{
+public:
+	AmpBackend(const accelerator& accl);
+	std::string name() const override { return name_; }
+	std::string description() const override { return description_; }
+	BackendCapabilities capabilities() const override;
+	bool supports(CALC_MANDELBROT method) const override;
+	bool render(const FrameRequest& request, const FrameTarget& target) override;
+	// prints the C++ AMP accelerator properties
+	void print_details(std::ostream& out) const override;
+private:
+	accelerator accl_;
+	std::string name_;
+	std::string description_;
+	// Different methods of calculating mandelbrot
+	void amp_mandelbrot(const FrameRequest& request, const FrameTarget& target);
+	void amp_pixel_mandelbrot(const FrameRequest& request, const FrameTarget& target);
+	void amp_barrier_mandelbrot(const FrameRequest& request, const FrameTarget& target);
+};
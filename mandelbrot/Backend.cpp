@@ -0,0 +1,79 @@
+#include "Backend.h"
+#include <algorithm>
+
+const char * method_name(CALC_MANDELBROT method)
+{
+	switch (method)
+	{
+	case AMP_MANDELBROT: return "amp_mandelbrot";
+	case AMP_PIXEL_MANDELBROT: return "amp_pixel_mandelbrot";
+	case AMP_BARRIER_MANDELBROT: return "amp_barrier_mandelbrot";
+	case CPU_MANDELBROT: return "cpu_mandelbrot";
+	}
+	return "unknown";
+}
+
+bool stores_iterations(CALC_MANDELBROT method)
+{
+	return method == AMP_MANDELBROT || method == CPU_MANDELBROT;
+}
+
+void Backend::print_details(std::ostream& out) const
+{
+	const BackendCapabilities caps = capabilities();
+	const char * bs[2] = { "false", "true" };
+	out << ": " << description()
+		<< "\n       supports_double_precision         = " << bs[caps.double_precision]
+		<< "\n       preferred_tile_size               = " << caps.preferred_tile_size
+		<< "\n       threads                           = " << caps.threads
+		<< "\n       is_emulated                       = " << bs[caps.emulated]
+		<< "\n       allocation_free                   = " << bs[caps.allocation_free]
+		<< "\n       progressive                       = " << bs[caps.progressive]
+		<< "\n\n";
+}
+
+void Backend::csv_row(std::ostream& out, double milliseconds) const
+{
+	out << milliseconds;
+}
+
+BackendRegistry& BackendRegistry::instance()
+{
+	static BackendRegistry registry;
+	return registry;
+}
+
+void BackendRegistry::add_factory(int priority, const Factory& factory)
+{
+	factories_.push_back(std::make_pair(priority, factory));
+}
+
+void BackendRegistry::create_backends()
+{
+	if (created_) { return; }
+	created_ = true;
+	std::stable_sort(factories_.begin(), factories_.end(),
+		[](const std::pair<int, Factory>& a, const std::pair<int, Factory>& b) { return a.first < b.first; });
+	for (auto& factory : factories_)
+	{
+		factory.second(backends_);
+	}
+}
+
+Backend * BackendRegistry::find(CALC_MANDELBROT method)
+{
+	for (auto& backend : backends_)
+	{
+		if (backend->supports(method)) { return backend.get(); }
+	}
+	return nullptr;
+}
+
+unsigned BackendRegistry::index_of(const Backend * backend) const
+{
+	for (unsigned i = 0; i < backends_.size(); ++i)
+	{
+		if (backends_[i].get() == backend) { return i; }
+	}
+	return size();
+}
@@ -0,0 +1,81 @@
+// Backend class
+// A compute backend calculates Mandelbrot frames on one device (a C++ AMP accelerator, the CPU engine, ...).
+// Backends register a factory with the BackendRegistry from their own source file,
+// so new fast paths are added without touching Mandelbrot::update().
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
+#include "Frame.h"
+
+// what a backend can do
+struct BackendCapabilities
+{
+	bool double_precision;        // supports double precision arithmetic
+	unsigned preferred_tile_size; // tile size it runs best with
+	unsigned threads;             // number of hardware threads it uses (0 if unknown)
+	bool emulated;                // software emulation (slow, only use for debugging)
+	bool allocation_free;         // renders without heap allocations once warmed up (checked in debug builds)
+	bool progressive;             // calculates every frame in parts reported to FrameTarget::progress
+};
+
+class Backend
+{
+public:
+	virtual ~Backend() {}
+	// short name used in timing file names
+	virtual std::string name() const = 0;
+	// human readable description of the device
+	virtual std::string description() const = 0;
+	virtual BackendCapabilities capabilities() const = 0;
+	// can the backend run this calculation method
+	virtual bool supports(CALC_MANDELBROT method) const = 0;
+	// calculate the frame into the buffers of the target
+	// returns false if the request was cancelled before the frame was finished
+	virtual bool render(const FrameRequest& request, const FrameTarget& target) = 0;
+	// give back memory kept between frames (e.g. for resuming) - called when another backend is used or memory is low
+	virtual void release_buffers() {}
+	// print device details at startup
+	virtual void print_details(std::ostream& out) const;
+	// extra statistics of the last frame - printed to the console and appended to the timing file
+	virtual void print_frame_stats(std::ostream& /*out*/) const {}
+	virtual std::string csv_header() const { return "milliseconds"; }
+	// written straight into the timing file, so a timing run doesn't allocate a string per frame
+	virtual void csv_row(std::ostream& out, double milliseconds) const;
+};
+
+// list of all backends available on this machine
+class BackendRegistry
+{
+public:
+	// adds the backends a factory finds to the list
+	typedef std::function<void(std::vector<std::unique_ptr<Backend>>& backends)> Factory;
+
+	static BackendRegistry& instance();
+	// called by the backends' source files - lower priority factories are listed first
+	void add_factory(int priority, const Factory& factory);
+	// run all factories (once)
+	void create_backends();
+	unsigned size() const { return (unsigned)backends_.size(); }
+	Backend& operator[](unsigned i) { return *backends_[i]; }
+	// first backend able to run the method (nullptr if none)
+	Backend * find(CALC_MANDELBROT method);
+	// number of the backend in the list (size() if not found)
+	unsigned index_of(const Backend * backend) const;
+private:
+	BackendRegistry() : created_(false) {}
+	std::vector<std::pair<int, Factory>> factories_;
+	std::vector<std::unique_ptr<Backend>> backends_;
+	bool created_;
+};
+
+// registers a backend factory during static initialisation
+struct BackendRegistrar
+{
+	BackendRegistrar(int priority, const BackendRegistry::Factory& factory)
+	{
+		BackendRegistry::instance().add_factory(priority, factory);
+	}
+};
@@ -0,0 +1,20 @@
+// CancelToken class
+// Cooperative cancellation of a frame. Every render request gets a generation number;
+// the request is cancelled as soon as a newer one is submitted (latest wins).
+// Long calculations check cancelled() between tiles and give up early.
+#pragma once
+#include <atomic>
+
+class CancelToken
+{
+public:
+	// a token that is never cancelled
+	CancelToken() : latest_(nullptr), generation_(0) {}
+	CancelToken(const std::atomic<unsigned long> * latest, unsigned long generation) : latest_(latest), generation_(generation) {}
+	bool cancelled() const { return latest_ != nullptr && latest_->load(std::memory_order_relaxed) != generation_; }
+	unsigned long generation() const { return generation_; }
+private:
+	// generation of the newest request
+	const std::atomic<unsigned long> * latest_;
+	unsigned long generation_;
+};
@@ -0,0 +1,119 @@
+#include "CpuBackend.h"
+#include <sstream>
+
+CpuBackend::CpuBackend(const std::string& name, const std::string& description, unsigned thread_count, KERNEL_ISA isa) :
+	name_(name),
+	description_(description),
+	engine_(TILE_SIZE, thread_count)
+{
+	engine_.set_isa(isa);
+}
+
+std::string CpuBackend::description() const
+{
+	std::ostringstream out;
+	out << description_ << " (" << engine_.thread_count() << " threads, " << isa_name(engine_.isa()) << " "
+		<< precision_name(engine_.precision()) << " kernel)";
+	return out.str();
+}
+
+BackendCapabilities CpuBackend::capabilities() const
+{
+	// cache misses allocate new tiles, the number of rectangles a subdivided frame needs depends on the view
+	return BackendCapabilities{ engine_.precision() == PRECISION_DOUBLE, TILE_SIZE, engine_.thread_count(), false,
+		!engine_.tile_cache_enabled() && engine_.mode() == MODE_TILES,
+		!engine_.tile_cache_enabled() && (engine_.mode() == MODE_REFINE || engine_.mode() == MODE_SLICED) };
+}
+
+// Render the escape counts of the Mandelbrot set into the iterations array.
+// The frame is split into TILE_SIZE x TILE_SIZE tiles which are calculated by the worker threads of the engine
+// (in parts reported to target.progress, the centre first, when it is set - every frame of the refine and sliced modes is)
+bool CpuBackend::render(const FrameRequest& request, const FrameTarget& target)
+{
+	engine_.set_size(request.width, request.height);
+	engine_.set_focus(request.focus_x, request.focus_y, request.focus_first);
+	engine_.set_escape_radius(request.escape_radius);
+	return engine_.render(target.iterations, request.left, request.right, request.top, request.bottom, request.max_iter,
+		request.reuse_previous, request.cancel, target.progress);
+}
+
+void CpuBackend::print_frame_stats(std::ostream& out) const
+{
+	// per-frame timing to check how throughput scales with the number of threads
+	const FrameTiming& timing = engine_.timing();
+	out << "  " << timing.threads << " threads, " << timing.tiles << " tiles and "
+		<< isa_name(timing.isa) << " " << precision_name(timing.precision) << " kernel: " << timing.milliseconds << " ms (" << timing.megapixels_per_second << " Mpixels/s)" << std::endl;
+	if (timing.mode != MODE_TILES)
+	{
+		const double pixels = double(timing.pixels_iterated) + timing.pixels_filled;
+		out << "  " << mode_name(timing.mode) << " mode: " << timing.pixels_iterated << " pixels iterated, " << timing.pixels_filled
+			<< " filled (" << (pixels > 0.0 ? 100.0 * timing.pixels_filled / pixels : 0.0) << "%)";
+		if (timing.mode == MODE_SUBDIVIDE) { out << ", " << timing.rects_rejected << " fills rejected by the points checked inside"; }
+		if (timing.mode == MODE_REFINE)
+		{
+			out << ", " << timing.guesses_rejected << " guesses rejected by a centre, first pass after " << timing.first_pass_ms << " ms";
+		}
+		if (timing.mode == MODE_SLICED)
+		{
+			out << ", " << timing.tiles << " rounds, " << timing.first_round_active << " pixels still active after the first";
+		}
+		out << std::endl;
+	}
+	else
+	{
+		out << "  " << timing.pixels_iterated << " pixels iterated, the rest reused from the previous frame" << std::endl;
+		if (!engine_.tile_cache_enabled())
+		{
+			out << "  focus pixel (" << engine_.focus_x() << ", " << engine_.focus_y() << ") calculated after " << timing.focus_ms
+				<< " ms (" << (engine_.focus_first() ? "nearest tiles first" : "row by row") << ")" << std::endl;
+		}
+	}
+	if (engine_.interior_checks())
+	{
+		const InteriorStats& interior = timing.interior;
+		out << "  interior checks: " << interior.cardioid_points << " pixels in the cardioid or bulb ("
+			<< interior.cardioid_iterations << " iterations saved), " << interior.periodic_points << " periodic pixels ("
+			<< interior.periodic_iterations << " iterations saved)" << std::endl;
+	}
+	if (engine_.tile_cache_enabled())
+	{
+		const TileCacheStats cache = engine_.tile_cache().stats();
+		out << "  tile cache: " << cache.frame_hits << " hits, " << cache.frame_misses << " misses, " << cache.frame_evictions
+			<< " evictions (" << cache.hits << ", " << cache.misses << " and " << cache.evictions << " in total), "
+			<< cache.tiles << " tiles, " << cache.bytes / (1024 * 1024) << " of " << cache.budget / (1024 * 1024) << " MB" << std::endl;
+	}
+	// per worker busy time shows how evenly the tiles were spread
+	const PoolStats& stats = engine_.pool_stats();
+	out << "  " << schedule_name(timing.schedule) << " schedule: " << stats.steals << " steals, "
+		<< stats.idle_ms << " ms idle waiting for the last worker" << std::endl;
+	for (unsigned i = 0; i < stats.workers.size(); ++i)
+	{
+		out << "  worker " << i << ": " << stats.workers[i].tasks << " tiles, " << stats.workers[i].steals << " steals, busy "
+			<< stats.workers[i].busy_ms << " ms, finished after " << stats.workers[i].finish_ms << " ms" << std::endl;
+	}
+}
+
+std::string CpuBackend::csv_header() const
+{
+	return "milliseconds,threads,tiles,kernel,precision,schedule,engine_milliseconds,megapixels_per_second,steals,idle_milliseconds,pixels_iterated,"
+		"cardioid_pixels,cardioid_iterations_saved,periodic_pixels,periodic_iterations_saved,mode,pixels_filled,rects_rejected,guesses_rejected,first_pass_milliseconds,first_round_active,focus_milliseconds";
+}
+
+void CpuBackend::csv_row(std::ostream& out, double milliseconds) const
+{
+	const FrameTiming& timing = engine_.timing();
+	out << milliseconds << "," << timing.threads << "," << timing.tiles << "," << isa_name(timing.isa) << "," << precision_name(timing.precision) << ","
+		<< schedule_name(timing.schedule) << "," << timing.milliseconds << "," << timing.megapixels_per_second << ","
+		<< timing.steals << "," << timing.idle_ms << "," << timing.pixels_iterated << ","
+		<< timing.interior.cardioid_points << "," << timing.interior.cardioid_iterations << ","
+		<< timing.interior.periodic_points << "," << timing.interior.periodic_iterations << ","
+		<< mode_name(timing.mode) << "," << timing.pixels_filled << "," << timing.rects_rejected << "," << timing.guesses_rejected << "," << timing.first_pass_ms << "," << timing.first_round_active << "," << timing.focus_ms;
+}
+
+// CPU backends are listed after the C++ AMP accelerators
+static BackendRegistrar cpu_backends(100, [](std::vector<std::unique_ptr<Backend>>& backends)
+{
+	backends.push_back(std::unique_ptr<Backend>(new CpuBackend("cpu_scalar", "CPU scalar", 1, ISA_SCALAR)));
+	backends.push_back(std::unique_ptr<Backend>(new CpuBackend("cpu_threaded", "CPU threaded", 0, ISA_SCALAR)));
+	backends.push_back(std::unique_ptr<Backend>(new CpuBackend("cpu_simd", "CPU SIMD", 0, detect_isa())));
+});
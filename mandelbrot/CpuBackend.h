@@ -0,0 +1,28 @@
+// CpuBackend class
+// Runs cpu_mandelbrot on a CpuEngine. Three variants register themselves:
+// scalar (one thread, scalar kernel), threaded (all threads, scalar kernel)
+// and SIMD (all threads, best SIMD kernel of the CPU), all iterating in double precision by default.
+#pragma once
+#include "Backend.h"
+#include "CpuEngine.h"
+
+class CpuBackend : public Backend
+{
+public:
+	CpuBackend(const std::string& name, const std::string& description, unsigned thread_count, KERNEL_ISA isa);
+	std::string name() const override { return name_; }
+	std::string description() const override;
+	BackendCapabilities capabilities() const override;
+	bool supports(CALC_MANDELBROT method) const override { return method == CPU_MANDELBROT; }
+	bool render(const FrameRequest& request, const FrameTarget& target) override;
+	void release_buffers() override { engine_.release_state(); }
+	void print_frame_stats(std::ostream& out) const override;
+	std::string csv_header() const override;
+	void csv_row(std::ostream& out, double milliseconds) const override;
+	// thread count, kernel and schedule can be changed at run time
+	CpuEngine& engine() { return engine_; }
+private:
+	std::string name_;
+	std::string description_;
+	CpuEngine engine_;
+};
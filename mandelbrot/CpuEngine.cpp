@@ -0,0 +1,1327 @@
+#include "CpuEngine.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+// std::fill takes it by reference
+const unsigned CpuEngine::PIXEL_PENDING;
+
+CpuEngine::CpuEngine(unsigned tile_size, unsigned thread_count) :
+	width_(0),
+	height_(0),
+	escape_radius_(2.0f),
+	tile_size_(tile_size),
+	pool_(nullptr),
+	best_isa_(detect_isa()),
+	precision_(PRECISION_DOUBLE),
+	schedule_(SCHEDULE_WORK_STEALING),
+	interior_checks_(true),
+	mode_(MODE_TILES),
+	verify_fills_(true),
+	refine_guess_(false),
+	focus_x_(0),
+	focus_y_(0),
+	focus_first_(true),
+	order_focus_tile_(0),
+	state_valid_(false),
+	state_max_iter_(0),
+	tile_cache_enabled_(false)
+{
+	set_thread_count(thread_count);
+	set_isa(best_isa_);
+	timing_ = FrameTiming{ 0.0, pool_->size(), 0, 0.0, isa_, precision_, schedule_, 0, 0.0, 0, InteriorStats(), mode_, 0, 0, 0, 0.0, 0, 0.0 };
+}
+
+void CpuEngine::set_thread_count(unsigned thread_count)
+{
+	// destroy the old pool first so its threads are joined before new ones are spawned
+	own_pool_.reset();
+	if (thread_count > 0) { own_pool_.reset(new ThreadPool(thread_count)); }
+	pool_ = thread_count > 0 ? own_pool_.get() : &ThreadPool::shared();
+	allocate_scratch();
+}
+
+void CpuEngine::set_size(unsigned width, unsigned height)
+{
+	if (width == width_ && height == height_) { return; }
+	width_ = width;
+	height_ = height;
+	focus_x_ = width / 2;
+	focus_y_ = height / 2;
+	// the tiles of the cache don't depend on the frame size
+	release_resume_state();
+	tile_order_.clear();
+}
+
+void CpuEngine::set_focus(unsigned x, unsigned y, bool focus_first)
+{
+	focus_x_ = x;
+	focus_y_ = y;
+	if (focus_first != focus_first_) { tile_order_.clear(); }
+	focus_first_ = focus_first;
+}
+
+void CpuEngine::release_state()
+{
+	release_resume_state();
+	tile_cache_.clear();
+}
+
+void CpuEngine::release_resume_state()
+{
+	// reallocated by the next render
+	state_valid_ = false;
+	std::vector<unsigned>().swap(counts_);
+	std::vector<double>().swap(zx_);
+	std::vector<double>().swap(zy_);
+	std::vector<unsigned char>().swap(traced_);
+	std::vector<double>().swap(active_cx_);
+	std::vector<double>().swap(active_cy_);
+	std::vector<double>().swap(active_zx_);
+	std::vector<double>().swap(active_zy_);
+	std::vector<unsigned>().swap(active_iterations_);
+	std::vector<unsigned>().swap(active_pixel_);
+}
+
+void CpuEngine::set_escape_radius(float escape_radius)
+{
+	if (escape_radius == escape_radius_) { return; }
+	escape_radius_ = escape_radius;
+	// the counts stored with the old radius can't be continued
+	state_valid_ = false;
+	tile_cache_.clear();
+}
+
+void CpuEngine::set_tile_cache(bool enabled)
+{
+	tile_cache_enabled_ = enabled;
+	if (!enabled) { tile_cache_.clear(); }
+}
+
+void CpuEngine::set_isa(KERNEL_ISA isa)
+{
+	isa_ = isa > best_isa_ ? best_isa_ : isa;
+	kernel_ = escape_kernel(isa_, precision_);
+}
+
+void CpuEngine::set_precision(KERNEL_PRECISION precision)
+{
+	if (precision == precision_) { return; }
+	precision_ = precision;
+	kernel_ = escape_kernel(isa_, precision_);
+	// the counts and z stored in the other precision aren't reused
+	state_valid_ = false;
+	tile_cache_.clear();
+}
+
+void CpuEngine::allocate_scratch()
+{
+	scratch_.resize(pool_->size());
+	for (auto& scratch : scratch_)
+	{
+		scratch.cx.resize(tile_size_ * tile_size_);
+		scratch.cy.resize(tile_size_ * tile_size_);
+		scratch.zx.resize(tile_size_ * tile_size_);
+		scratch.zy.resize(tile_size_ * tile_size_);
+		scratch.iterations.resize(tile_size_ * tile_size_);
+		scratch.pixel.resize(tile_size_ * tile_size_);
+	}
+}
+
+void CpuEngine::reset_scratch()
+{
+	for (auto& points : scratch_)
+	{
+		points.pixels_iterated = 0;
+		points.tiles_skipped = 0;
+		points.interior = InteriorStats();
+		points.pixels_filled = 0;
+		points.rects_rejected = 0;
+		points.guesses_rejected = 0;
+		points.queued = 0;
+	}
+}
+
+void CpuEngine::ensure_pending_state()
+{
+	// counts_ holds the pixels calculated so far (PIXEL_PENDING for the others), the z of the resume state isn't kept
+	state_valid_ = false;
+	if (counts_.empty())
+	{
+		counts_.resize(std::size_t(width_) * height_);
+		zx_.resize(std::size_t(width_) * height_);
+		zy_.resize(std::size_t(width_) * height_);
+	}
+}
+
+void CpuEngine::flush_points(TileScratch& points, unsigned count, unsigned max_iter)
+{
+	kernel_(EscapeJob{ points.cx.data(), points.cy.data(), points.iterations.data(), count, max_iter,
+		double(escape_radius_) * escape_radius_, nullptr, nullptr, interior_checks_ ? &points.interior : nullptr });
+	unsigned * counts = counts_.data();
+	for (unsigned i = 0; i < count; ++i)
+	{
+		counts[points.pixel[i]] = points.iterations[i];
+	}
+	points.pixels_iterated += count;
+}
+
+unsigned CpuEngine::record_timing(double milliseconds, unsigned tiles, unsigned steals, double idle_ms)
+{
+	timing_.milliseconds = milliseconds;
+	timing_.threads = pool_->size();
+	timing_.tiles = tiles;
+	timing_.isa = isa_;
+	timing_.precision = precision_;
+	timing_.schedule = schedule_;
+	timing_.steals = steals;
+	timing_.idle_ms = idle_ms;
+	timing_.megapixels_per_second = timing_.milliseconds > 0.0 ?
+		(double(width_) * height_ / 1.0e6) / (timing_.milliseconds / 1000.0) : 0.0;
+	timing_.pixels_iterated = 0;
+	timing_.interior = InteriorStats();
+	timing_.mode = mode_;
+	timing_.pixels_filled = 0;
+	timing_.rects_rejected = 0;
+	timing_.guesses_rejected = 0;
+	timing_.first_pass_ms = 0.0;
+	timing_.first_round_active = 0;
+	timing_.focus_ms = 0.0;
+	unsigned tiles_skipped = 0;
+	for (auto& points : scratch_)
+	{
+		timing_.pixels_iterated += points.pixels_iterated;
+		tiles_skipped += points.tiles_skipped;
+		timing_.interior.cardioid_points += points.interior.cardioid_points;
+		timing_.interior.cardioid_iterations += points.interior.cardioid_iterations;
+		timing_.interior.periodic_points += points.interior.periodic_points;
+		timing_.interior.periodic_iterations += points.interior.periodic_iterations;
+		timing_.pixels_filled += points.pixels_filled;
+		timing_.rects_rejected += points.rects_rejected;
+		timing_.guesses_rejected += points.guesses_rejected;
+	}
+	return tiles_skipped;
+}
+
+bool CpuEngine::render(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	bool resume, const CancelToken& cancel, FrameProgress * progress)
+{
+	// the shared pool may have been set to another schedule by the engine of another backend
+	pool_->set_schedule(schedule_);
+	if (tile_cache_enabled_) { return render_cached(iterations, left, right, top, bottom, max_iter, resume, cancel); }
+	if (mode_ == MODE_SUBDIVIDE) { return render_subdivided(iterations, left, right, top, bottom, max_iter, cancel); }
+	if (mode_ == MODE_BOUNDARY) { return render_traced(iterations, left, right, top, bottom, max_iter, cancel); }
+	if (mode_ == MODE_REFINE) { return render_refined(iterations, left, right, top, bottom, max_iter, cancel, progress); }
+	if (mode_ == MODE_SLICED) { return render_sliced(iterations, left, right, top, bottom, max_iter, cancel, progress); }
+
+	const unsigned tiles_x = (width_ + tile_size_ - 1) / tile_size_;
+	const unsigned tiles_y = (height_ + tile_size_ - 1) / tile_size_;
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const unsigned tile_size = tile_size_;
+	const double bailout = double(escape_radius_) * escape_radius_;
+	const EscapeKernelFunction kernel = kernel_;
+	const bool interior_checks = interior_checks_;
+	TileScratch * scratch = scratch_.data();
+
+	if (counts_.empty())
+	{
+		counts_.resize(std::size_t(width_) * height_);
+		zx_.resize(std::size_t(width_) * height_);
+		zy_.resize(std::size_t(width_) * height_);
+	}
+	// the stored state can only be reused for the same region or one panned by whole pixels
+	int dx = 0, dy = 0;
+	const bool panned = resume && state_valid_ && pan_offset(left, right, top, bottom, dx, dy);
+	resume = resume && state_valid_ && (panned ||
+		(state_left_ == left && state_right_ == right && state_top_ == top && state_bottom_ == bottom));
+	if (panned) { shift_state(dx, dy); }
+	// the parts of a progressive frame not calculated yet show the last frame (calculated in one go without one)
+	const bool progressive = progress != nullptr && !resume && state_valid_;
+	if (progressive) { reproject_state(iterations, left, right, top, bottom, max_iter); }
+	// pixels with a count below max_iter whose z didn't escape were stopped by a lower max_iter and are continued
+	// (without resume every pixel restarts from z = 0)
+	const bool continue_unfinished = resume && max_iter > state_max_iter_;
+	// a lower (or the same) max_iter doesn't need any iterations
+	const bool iterate = !resume || continue_unfinished || panned;
+	// the rows below the real axis mirroring rows above it are copied instead of iterated
+	const int mirror = iterate ? mirror_row(top, bottom) : -1;
+	const unsigned first_mirrored = mirror > 0 ? unsigned(mirror) / 2 + 1 : height;
+	const unsigned last_mirrored = mirror > 0 && unsigned(mirror) < height ? unsigned(mirror) : height - 1;
+	// only a row whose c_y is exactly the negated c_y of its partner has the same counts (rounding of
+	// the region can move the two apart by an ulp), the others are iterated
+	mirrored_rows_.assign(height, 0);
+	auto row_cy = [=](unsigned y) { return top + (y * (bottom - top) / height); };
+	for (unsigned y = first_mirrored; y <= last_mirrored; ++y)
+	{
+		const double cy = row_cy(y);
+		const double partner = -row_cy(unsigned(mirror) - y);
+		mirrored_rows_[y] = std::memcmp(&cy, &partner, sizeof(double)) == 0;
+	}
+	const unsigned char * mirrored = mirrored_rows_.data();
+	unsigned * counts = counts_.data();
+	double * state_zx = zx_.data();
+	double * state_zy = zy_.data();
+	reset_scratch();
+	// tile of the focus pixel (of the row it is copied from when it is mirrored)
+	const unsigned focus_x = focus_x_ < width ? focus_x_ : width - 1;
+	unsigned focus_y = focus_y_ < height ? focus_y_ : height - 1;
+	if (mirrored[focus_y]) { focus_y = unsigned(mirror) - focus_y; }
+	const unsigned focus_tile = (focus_y / tile_size) * tiles_x + focus_x / tile_size;
+	if (tile_order_.empty() || (focus_first_ && focus_tile != order_focus_tile_)) { order_tiles(tiles_x, tiles_y, focus_tile); }
+	double focus_ms = 0.0;
+	double * focus_time = &focus_ms;
+
+	auto start = std::chrono::steady_clock::now();
+	auto render_tile = [=](unsigned tile, unsigned worker)
+	{
+		// a newer frame was requested - skip the remaining tiles
+		if (cancel.cancelled())
+		{
+			++scratch[worker].tiles_skipped;
+			return;
+		}
+		const unsigned x0 = (tile % tiles_x) * tile_size;
+		const unsigned y0 = (tile / tiles_x) * tile_size;
+		const unsigned x1 = x0 + tile_size < width ? x0 + tile_size : width;
+		const unsigned y1 = y0 + tile_size < height ? y0 + tile_size : height;
+		if (iterate)
+		{
+			// Work out the points in the complex plane that
+			// correspond to the pixels of this tile still to be iterated.
+			TileScratch& points = scratch[worker];
+			unsigned count = 0;
+			for (unsigned x = x0; x < x1; ++x)
+			{
+				for (unsigned y = y0; y < y1; ++y)
+				{
+					if (mirrored[y]) { continue; }
+					const unsigned pixel = x * height + y;
+					if (!resume || counts[pixel] == PIXEL_PENDING)
+					{
+						points.zx[count] = 0.0;
+						points.zy[count] = 0.0;
+						points.iterations[count] = 0;
+					}
+					else if (continue_unfinished && counts[pixel] < max_iter &&
+						state_zx[pixel] * state_zx[pixel] + state_zy[pixel] * state_zy[pixel] < bailout)
+					{
+						points.zx[count] = state_zx[pixel];
+						points.zy[count] = state_zy[pixel];
+						points.iterations[count] = counts[pixel];
+					}
+					else
+					{
+						continue;
+					}
+					points.cx[count] = left + (x * (right - left) / width);
+					points.cy[count] = top + (y * (bottom - top) / height);
+					points.pixel[count] = pixel;
+					++count;
+				}
+			}
+			kernel(EscapeJob{ points.cx.data(), points.cy.data(), points.iterations.data(), count, max_iter, bailout,
+				points.zx.data(), points.zy.data(), interior_checks ? &points.interior : nullptr });
+			for (unsigned i = 0; i < count; ++i)
+			{
+				const unsigned pixel = points.pixel[i];
+				counts[pixel] = points.iterations[i];
+				state_zx[pixel] = points.zx[i];
+				state_zy[pixel] = points.zy[i];
+			}
+			points.pixels_iterated += count;
+		}
+		// counts above max_iter come from a frame calculated with a higher maximum
+		// (the mirrored rows are written by mirror_column once the rows they copy are calculated)
+		for (unsigned x = x0; x < x1; ++x)
+		{
+			for (unsigned y = y0; y < y1; ++y)
+			{
+				if (mirrored[y]) { continue; }
+				const unsigned count = counts[x * height + y];
+				iterations[x * height + y] = count < max_iter ? count : max_iter;
+			}
+		}
+		if (tile == focus_tile)
+		{
+			*focus_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	};
+	// row mirror - y of every column is the complex conjugate of row y (the same count, z conjugated)
+	// only the rows whose source is in the first done tiles of the order are copied - the other sources
+	// still hold the last frame's counts
+	const unsigned * rank = tile_rank_.data();
+	auto mirror_column = [=](unsigned x, unsigned done)
+	{
+		for (unsigned y = first_mirrored; y <= last_mirrored; ++y)
+		{
+			if (!mirrored[y] || rank[((mirror - y) / tile_size) * tiles_x + x / tile_size] >= done) { continue; }
+			const std::size_t source = std::size_t(x) * height + (mirror - y);
+			const std::size_t pixel = std::size_t(x) * height + y;
+			counts[pixel] = counts[source];
+			state_zx[pixel] = state_zx[source];
+			state_zy[pixel] = -state_zy[source];
+			iterations[pixel] = iterations[source];
+		}
+	};
+	// a progressive frame is calculated in parts, the tiles nearest to the centre first
+	const unsigned tile_count = tiles_x * tiles_y;
+	const unsigned parts = progressive ? PROGRESS_PARTS : 1;
+	const unsigned * order = tile_order_.data();
+	unsigned steals = 0;
+	double idle_ms = 0.0;
+	bool stopped = false;
+	for (unsigned part = 0; part < parts; ++part)
+	{
+		const unsigned first = tile_count * part / parts;
+		const unsigned last = tile_count * (part + 1) / parts;
+		pool_->run(last - first, [&](unsigned i, unsigned worker) { render_tile(order[first + i], worker); });
+		steals += pool_->stats().steals;
+		idle_ms += pool_->stats().idle_ms;
+		if (first_mirrored <= last_mirrored && !cancel.cancelled())
+		{
+			pool_->run(width, [=](unsigned x, unsigned /*worker*/) { mirror_column(x, last); });
+		}
+		if (part + 1 == parts) { break; }
+		// a newer frame was requested between two parts
+		if (cancel.cancelled())
+		{
+			stopped = true;
+			break;
+		}
+		progress->frame_progress(last, tile_count);
+	}
+	auto end = std::chrono::steady_clock::now();
+	const unsigned tiles_skipped = record_timing(std::chrono::duration<double, std::milli>(end - start).count(),
+		tile_count, steals, idle_ms);
+	timing_.focus_ms = focus_ms;
+	// the stored state is partly from this frame and partly from the last one
+	if (tiles_skipped > 0 || stopped)
+	{
+		state_valid_ = false;
+		return false;
+	}
+
+	state_valid_ = true;
+	state_left_ = left;
+	state_right_ = right;
+	state_top_ = top;
+	state_bottom_ = bottom;
+	// a lower max_iter takes the counts as they are (the pixels stopped at a higher one are continued from there)
+	state_max_iter_ = max_iter;
+	return true;
+}
+
+bool CpuEngine::pan_offset(double left, double right, double top, double bottom, int& dx, int& dy) const
+{
+	// the pixel size has to stay the same (up to rounding of the region)
+	const double step_x = (state_right_ - state_left_) / width_;
+	const double step_y = (state_bottom_ - state_top_) / height_;
+	if (std::fabs((right - left) - (state_right_ - state_left_)) > std::fabs(step_x) * 1.0e-3 ||
+		std::fabs((bottom - top) - (state_bottom_ - state_top_)) > std::fabs(step_y) * 1.0e-3)
+	{
+		return false;
+	}
+	const double offset_x = (left - state_left_) / step_x;
+	const double offset_y = (top - state_top_) / step_y;
+	dx = (int)std::lround(offset_x);
+	dy = (int)std::lround(offset_y);
+	// a fraction of a pixel would move every stored point
+	if (std::fabs(offset_x - dx) > 1.0e-2 || std::fabs(offset_y - dy) > 1.0e-2) { return false; }
+	// the same region goes through the normal resume path
+	return (dx != 0 || dy != 0) && std::abs(dx) < (int)width_ && std::abs(dy) < (int)height_;
+}
+
+void CpuEngine::shift_state(int dx, int dy)
+{
+	// pixel (x, y) of the new frame is pixel (x + dx, y + dy) of the stored one.
+	// The columns are moved in place, in the order that reads each column before it is overwritten.
+	const int width = (int)width_;
+	const int height = (int)height_;
+	const int rows = height - std::abs(dy);
+	const int from_y = dy > 0 ? dy : 0; // first stored row kept
+	const int to_y = dy < 0 ? -dy : 0;  // where it goes
+	for (int i = 0; i < width; ++i)
+	{
+		const int x = dx > 0 ? i : width - 1 - i;
+		const int source = x + dx;
+		unsigned * counts = counts_.data() + std::size_t(x) * height;
+		if (source < 0 || source >= width)
+		{
+			std::fill(counts, counts + height, PIXEL_PENDING);
+			continue;
+		}
+		const std::size_t from = std::size_t(source) * height + from_y;
+		const std::size_t to = std::size_t(x) * height + to_y;
+		std::memmove(&counts_[to], &counts_[from], rows * sizeof(unsigned));
+		std::memmove(&zx_[to], &zx_[from], rows * sizeof(double));
+		std::memmove(&zy_[to], &zy_[from], rows * sizeof(double));
+		// rows that came into view at the top or bottom
+		if (dy > 0) { std::fill(counts + rows, counts + height, PIXEL_PENDING); }
+		else { std::fill(counts, counts + to_y, PIXEL_PENDING); }
+	}
+}
+
+int CpuEngine::mirror_row(double top, double bottom) const
+{
+	// row y is at top + y * step, its conjugate at -top - y * step = top + (mirror - y) * step
+	const double step = (bottom - top) / height_;
+	const double mirror = -2.0 * top / step;
+	const int row = (int)std::lround(mirror);
+	// the rows have to line up to a small fraction of a pixel (anything more is rounding of the region)
+	if (std::fabs(mirror - row) > 1.0e-3) { return -1; }
+	// at least one pair of rows inside the frame
+	return row >= 2 && row <= 2 * (int)height_ - 4 ? row : -1;
+}
+
+void CpuEngine::order_tiles(unsigned tiles_x, unsigned tiles_y, unsigned focus_tile)
+{
+	tile_order_.resize(tiles_x * tiles_y);
+	order_focus_tile_ = focus_tile;
+	for (unsigned tile = 0; tile < tile_order_.size(); ++tile)
+	{
+		tile_order_[tile] = tile;
+	}
+	if (focus_first_)
+	{
+		// distance from the focus tile in tiles
+		const int focus_x = int(focus_tile % tiles_x);
+		const int focus_y = int(focus_tile / tiles_x);
+		auto distance = [=](unsigned tile)
+		{
+			const int dx = int(tile % tiles_x) - focus_x;
+			const int dy = int(tile / tiles_x) - focus_y;
+			return dx * dx + dy * dy;
+		};
+		std::stable_sort(tile_order_.begin(), tile_order_.end(),
+			[&](unsigned a, unsigned b) { return distance(a) < distance(b); });
+	}
+	tile_rank_.resize(tile_order_.size());
+	for (unsigned i = 0; i < tile_order_.size(); ++i)
+	{
+		tile_rank_[tile_order_[i]] = i;
+	}
+}
+
+void CpuEngine::reproject_state(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const double state_left = state_left_;
+	const double state_top = state_top_;
+	const double state_step_x = (state_right_ - state_left_) / width;
+	const double state_step_y = (state_bottom_ - state_top_) / height;
+	const double step_x = (right - left) / width;
+	const double step_y = (bottom - top) / height;
+	const unsigned * counts = counts_.data();
+	// nearest stored pixel of every column and row, -1 outside the last frame (drawn with a count of 0)
+	pool_->run(width, [=](unsigned x, unsigned /*worker*/)
+	{
+		const int source_x = (int)std::floor((left + (x + 0.5) * step_x - state_left) / state_step_x);
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const int source_y = (int)std::floor((top + (y + 0.5) * step_y - state_top) / state_step_y);
+			unsigned count = 0;
+			if (source_x >= 0 && source_x < (int)width && source_y >= 0 && source_y < (int)height)
+			{
+				count = counts[std::size_t(source_x) * height + source_y];
+			}
+			iterations[std::size_t(x) * height + y] = count < max_iter ? count : max_iter;
+		}
+	});
+}
+
+// number of the cache tile holding grid point g (rounded down for negative points too)
+static int64_t cache_tile(int64_t g)
+{
+	const int64_t tile = TileCache::TILE;
+	return g >= 0 ? g / tile : -((-g + tile - 1) / tile);
+}
+
+bool CpuEngine::render_cached(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	bool resume, const CancelToken& cancel)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const unsigned tile = TileCache::TILE;
+	const double bailout = double(escape_radius_) * escape_radius_;
+	const EscapeKernelFunction kernel = kernel_;
+	const bool interior_checks = interior_checks_;
+	const unsigned capacity = tile_size_ * tile_size_;
+	TileScratch * scratch = scratch_.data();
+	// the resume state isn't kept up to date while the frames come from the cache
+	state_valid_ = false;
+	reset_scratch();
+
+	auto start = std::chrono::steady_clock::now();
+	// grid point nearest to every pixel on the finest level at least as fine as the frame
+	const double step_x = (double(right) - left) / width;
+	const double step_y = (double(bottom) - top) / height;
+	const int level = TileCache::level_for(std::fabs(step_x) < std::fabs(step_y) ? std::fabs(step_x) : std::fabs(step_y));
+	const double step = TileCache::level_step(level);
+	auto grid = [=](double c) { return (int64_t)std::floor(c / step + 0.5); };
+	const int64_t gx0 = grid(left);
+	const int64_t gx1 = grid(left + (width - 1) * step_x);
+	const int64_t gy0 = grid(top);
+	const int64_t gy1 = grid(top + (height - 1) * step_y);
+	const int64_t tx0 = cache_tile(gx0 < gx1 ? gx0 : gx1);
+	const int64_t ty0 = cache_tile(gy0 < gy1 ? gy0 : gy1);
+	const unsigned tiles_x = unsigned(cache_tile(gx0 < gx1 ? gx1 : gx0) - tx0 + 1);
+	const unsigned tiles_y = unsigned(cache_tile(gy0 < gy1 ? gy1 : gy0) - ty0 + 1);
+
+	// look the tiles up - the missing ones are calculated (timing runs calculate all of them)
+	tile_cache_.start_frame();
+	cached_tiles_.resize(tiles_x * tiles_y);
+	missing_tiles_.clear();
+	for (unsigned i = 0; i < tiles_x; ++i)
+	{
+		for (unsigned j = 0; j < tiles_y; ++j)
+		{
+			CachedTile& cached = cached_tiles_[i * tiles_y + j];
+			cached.key = TileCache::Key{ level, tx0 + i, ty0 + j };
+			cached.counts = resume ? tile_cache_.find(cached.key, max_iter) : nullptr;
+			cached.missing = cached.counts == nullptr;
+			cached.cost = 0.0;
+			if (cached.missing)
+			{
+				cached.counts = tile_cache_.insert(cached.key, max_iter);
+				missing_tiles_.push_back(i * tiles_y + j);
+			}
+		}
+	}
+
+	CachedTile * cached_tiles = cached_tiles_.data();
+	const unsigned * missing = missing_tiles_.data();
+	pool_->run((unsigned)missing_tiles_.size(), [=](unsigned task, unsigned worker)
+	{
+		if (cancel.cancelled())
+		{
+			++scratch[worker].tiles_skipped;
+			return;
+		}
+		CachedTile& cached = cached_tiles[missing[task]];
+		uint32_t * counts = const_cast<uint32_t *>(cached.counts);
+		TileScratch& points = scratch[worker];
+		// the tile is calculated capacity points at a time
+		for (unsigned first = 0; first < tile * tile; first += capacity)
+		{
+			const unsigned count = tile * tile - first < capacity ? tile * tile - first : capacity;
+			for (unsigned k = 0; k < count; ++k)
+			{
+				const unsigned point = first + k;
+				points.cx[k] = (cached.key.x * tile + point / tile) * step;
+				points.cy[k] = (cached.key.y * tile + point % tile) * step;
+				points.zx[k] = 0.0f;
+				points.zy[k] = 0.0f;
+				points.iterations[k] = 0;
+			}
+			kernel(EscapeJob{ points.cx.data(), points.cy.data(), points.iterations.data(), count, max_iter, bailout,
+				points.zx.data(), points.zy.data(), interior_checks ? &points.interior : nullptr });
+			for (unsigned k = 0; k < count; ++k)
+			{
+				counts[first + k] = points.iterations[k];
+				cached.cost += points.iterations[k];
+			}
+		}
+		points.pixels_iterated += tile * tile;
+	});
+	const unsigned steals = pool_->stats().steals;
+	const double idle_ms = pool_->stats().idle_ms;
+	bool cancelled = false;
+	for (auto& points : scratch_)
+	{
+		cancelled = cancelled || points.tiles_skipped > 0;
+	}
+	for (unsigned task = 0; task < missing_tiles_.size(); ++task)
+	{
+		const CachedTile& cached = cached_tiles_[missing_tiles_[task]];
+		if (cancelled) { tile_cache_.erase(cached.key); }
+		else { tile_cache_.commit(cached.key, cached.cost); }
+	}
+
+	if (!cancelled)
+	{
+		// row of every pixel in its cache tile
+		cached_rows_.resize(height);
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const int64_t gy = grid(top + y * step_y);
+			cached_rows_[y] = unsigned((cache_tile(gy) - ty0) * tile + (gy - cache_tile(gy) * tile));
+		}
+		const unsigned * rows = cached_rows_.data();
+		pool_->run(width, [=](unsigned x, unsigned /*worker*/)
+		{
+			const int64_t gx = grid(left + x * step_x);
+			const unsigned column = unsigned(cache_tile(gx) - tx0);
+			const unsigned point = unsigned(gx - cache_tile(gx) * tile) * tile;
+			const CachedTile * tile_column = cached_tiles + column * tiles_y;
+			for (unsigned y = 0; y < height; ++y)
+			{
+				const unsigned count = tile_column[rows[y] / tile].counts[point + rows[y] % tile];
+				iterations[std::size_t(x) * height + y] = count < max_iter ? count : max_iter;
+			}
+		});
+		// the tiles of this frame were used last, so they are the last to go
+		tile_cache_.trim();
+	}
+	auto end = std::chrono::steady_clock::now();
+	record_timing(std::chrono::duration<double, std::milli>(end - start).count(), tiles_x * tiles_y, steals, idle_ms);
+	return !cancelled;
+}
+
+bool CpuEngine::render_subdivided(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	const CancelToken& cancel)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const bool verify_fills = verify_fills_;
+	const unsigned capacity = tile_size_ * tile_size_;
+	TileScratch * scratch = scratch_.data();
+	ensure_pending_state();
+	unsigned * counts = counts_.data();
+	reset_scratch();
+
+	auto start = std::chrono::steady_clock::now();
+	// the points queued in the scratch buffers of a worker are iterated once they fill them or the round is over
+	auto flush = [=](TileScratch& points)
+	{
+		flush_points(points, points.queued, max_iter);
+		points.queued = 0;
+	};
+	auto queue = [=](TileScratch& points, unsigned x, unsigned y)
+	{
+		const unsigned pixel = x * height + y;
+		if (counts[pixel] != PIXEL_PENDING) { return; }
+		points.cx[points.queued] = left + (x * (right - left) / width);
+		points.cy[points.queued] = top + (y * (bottom - top) / height);
+		points.pixel[points.queued] = pixel;
+		if (++points.queued == capacity) { flush(points); }
+	};
+	auto flush_all = [=](unsigned i, unsigned /*worker*/) { flush(scratch[i]); };
+	const unsigned workers = pool_->size();
+
+	// the rectangles share their borders - calculate the lines between them column by column
+	const unsigned start_size = SUBDIVIDE_START;
+	pool_->run(width, [=](unsigned x, unsigned worker)
+	{
+		unsigned * column = counts + std::size_t(x) * height;
+		std::fill(column, column + height, PIXEL_PENDING);
+		TileScratch& points = scratch[worker];
+		const bool whole_column = x % start_size == 0 || x == width - 1;
+		for (unsigned y = 0; y < height; ++y)
+		{
+			if (whole_column || y % start_size == 0 || y == height - 1) { queue(points, x, y); }
+		}
+	});
+	pool_->run(workers, flush_all);
+	rects_.clear();
+	for (unsigned x0 = 0; x0 + 1 < width; x0 += start_size)
+	{
+		for (unsigned y0 = 0; y0 + 1 < height; y0 += start_size)
+		{
+			rects_.push_back(Rect{ x0, y0, std::min(x0 + start_size, width - 1), std::min(y0 + start_size, height - 1), false });
+		}
+	}
+
+	auto subdivide = [=](const Rect& rect, unsigned worker)
+	{
+		TileScratch& points = scratch[worker];
+		if (cancel.cancelled())
+		{
+			++points.tiles_skipped;
+			return;
+		}
+		// nothing inside the border
+		if (rect.x1 - rect.x0 < 2 || rect.y1 - rect.y0 < 2) { return; }
+		if (rect.x1 - rect.x0 < SUBDIVIDE_MIN_SIZE || rect.y1 - rect.y0 < SUBDIVIDE_MIN_SIZE)
+		{
+			for (unsigned x = rect.x0 + 1; x < rect.x1; ++x)
+			{
+				for (unsigned y = rect.y0 + 1; y < rect.y1; ++y)
+				{
+					queue(points, x, y);
+				}
+			}
+			return;
+		}
+		const unsigned border = counts[rect.x0 * height + rect.y0];
+		bool uniform = true;
+		for (unsigned x = rect.x0; x <= rect.x1 && uniform; ++x)
+		{
+			uniform = counts[x * height + rect.y0] == border && counts[x * height + rect.y1] == border;
+		}
+		for (unsigned y = rect.y0; y <= rect.y1 && uniform; ++y)
+		{
+			uniform = counts[rect.x0 * height + y] == border && counts[rect.x1 * height + y] == border;
+		}
+		const unsigned middle_x = (rect.x0 + rect.x1) / 2;
+		const unsigned middle_y = (rect.y0 + rect.y1) / 2;
+		// a filament of the set or a band of another count can pass through without touching the border -
+		// the middle column and row and the centres of the quarters have to agree with it too (they are
+		// iterated with the rest of this round, the rectangle is filled or split in the next one, which
+		// reuses the middle column and row as the borders of the quarters)
+		const unsigned quarter_x = (rect.x1 - rect.x0) / 4;
+		const unsigned quarter_y = (rect.y1 - rect.y0) / 4;
+		if (uniform && verify_fills && !rect.checked)
+		{
+			for (unsigned y = rect.y0 + 1; y < rect.y1; ++y)
+			{
+				queue(points, middle_x, y);
+			}
+			for (unsigned x = rect.x0 + 1; x < rect.x1; ++x)
+			{
+				queue(points, x, middle_y);
+			}
+			queue(points, rect.x0 + quarter_x, rect.y0 + quarter_y);
+			queue(points, rect.x1 - quarter_x, rect.y0 + quarter_y);
+			queue(points, rect.x0 + quarter_x, rect.y1 - quarter_y);
+			queue(points, rect.x1 - quarter_x, rect.y1 - quarter_y);
+			points.rects.push_back(Rect{ rect.x0, rect.y0, rect.x1, rect.y1, true });
+			return;
+		}
+		if (uniform && rect.checked)
+		{
+			for (unsigned y = rect.y0 + 1; y < rect.y1 && uniform; ++y)
+			{
+				uniform = counts[middle_x * height + y] == border;
+			}
+			for (unsigned x = rect.x0 + 1; x < rect.x1 && uniform; ++x)
+			{
+				uniform = counts[x * height + middle_y] == border;
+			}
+			uniform = uniform &&
+				counts[(rect.x0 + quarter_x) * height + rect.y0 + quarter_y] == border &&
+				counts[(rect.x1 - quarter_x) * height + rect.y0 + quarter_y] == border &&
+				counts[(rect.x0 + quarter_x) * height + rect.y1 - quarter_y] == border &&
+				counts[(rect.x1 - quarter_x) * height + rect.y1 - quarter_y] == border;
+			if (!uniform) { ++points.rects_rejected; }
+		}
+		if (uniform)
+		{
+			for (unsigned x = rect.x0 + 1; x < rect.x1; ++x)
+			{
+				for (unsigned y = rect.y0 + 1; y < rect.y1; ++y)
+				{
+					unsigned& pixel = counts[x * height + y];
+					if (pixel == PIXEL_PENDING)
+					{
+						pixel = border;
+						++points.pixels_filled;
+					}
+				}
+			}
+			return;
+		}
+		// the middle column and row become the borders of the four quarters
+		for (unsigned y = rect.y0 + 1; y < rect.y1; ++y)
+		{
+			queue(points, middle_x, y);
+		}
+		for (unsigned x = rect.x0 + 1; x < rect.x1; ++x)
+		{
+			if (x != middle_x) { queue(points, x, middle_y); }
+		}
+		points.rects.push_back(Rect{ rect.x0, rect.y0, middle_x, middle_y, false });
+		points.rects.push_back(Rect{ middle_x, rect.y0, rect.x1, middle_y, false });
+		points.rects.push_back(Rect{ rect.x0, middle_y, middle_x, rect.y1, false });
+		points.rects.push_back(Rect{ middle_x, middle_y, rect.x1, rect.y1, false });
+	};
+	// one round per level of subdivision - the rectangles of a round don't overlap inside their borders
+	unsigned rect_count = 0;
+	unsigned steals = 0;
+	double idle_ms = 0.0;
+	while (!rects_.empty() && !cancel.cancelled())
+	{
+		const Rect * rects = rects_.data();
+		pool_->run((unsigned)rects_.size(), [=](unsigned i, unsigned worker) { subdivide(rects[i], worker); });
+		rect_count += (unsigned)rects_.size();
+		steals += pool_->stats().steals;
+		idle_ms += pool_->stats().idle_ms;
+		pool_->run(workers, flush_all);
+		rects_.clear();
+		for (auto& points : scratch_)
+		{
+			rects_.insert(rects_.end(), points.rects.begin(), points.rects.end());
+			points.rects.clear();
+		}
+	}
+	const bool cancelled = !rects_.empty() || cancel.cancelled();
+	if (!cancelled)
+	{
+		std::copy(counts_.begin(), counts_.end(), iterations);
+	}
+	auto end = std::chrono::steady_clock::now();
+	record_timing(std::chrono::duration<double, std::milli>(end - start).count(), rect_count, steals, idle_ms);
+	return !cancelled;
+}
+
+bool CpuEngine::render_traced(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	const CancelToken& cancel)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const bool verify_fills = verify_fills_;
+	const unsigned capacity = tile_size_ * tile_size_;
+	TileScratch * scratch = scratch_.data();
+	ensure_pending_state();
+	if (traced_.empty()) { traced_.resize(std::size_t(width_) * height_); }
+	unsigned * counts = counts_.data();
+	unsigned char * traced = traced_.data();
+	reset_scratch();
+
+	auto start = std::chrono::steady_clock::now();
+	const unsigned region = BOUNDARY_REGION;
+	const unsigned regions_x = (width + region - 1) / region;
+	const unsigned regions_y = (height + region - 1) / region;
+	auto trace_region = [=](unsigned task, unsigned worker)
+	{
+		TileScratch& points = scratch[worker];
+		// a newer frame was requested - skip the remaining regions
+		if (cancel.cancelled())
+		{
+			++points.tiles_skipped;
+			return;
+		}
+		const unsigned x0 = (task % regions_x) * region;
+		const unsigned y0 = (task / regions_x) * region;
+		const unsigned x1 = x0 + region < width ? x0 + region : width;
+		const unsigned y1 = y0 + region < height ? y0 + region : height;
+		for (unsigned x = x0; x < x1; ++x)
+		{
+			std::fill(counts + std::size_t(x) * height + y0, counts + std::size_t(x) * height + y1, PIXEL_PENDING);
+			std::fill(traced + std::size_t(x) * height + y0, traced + std::size_t(x) * height + y1, (unsigned char)0);
+		}
+
+		// the pixels to calculate are batched in the scratch buffers
+		unsigned count = 0;
+		auto flush = [&]()
+		{
+			flush_points(points, count, max_iter);
+			count = 0;
+		};
+		auto calculate = [&](unsigned pixel)
+		{
+			if (traced[pixel] & TRACE_CALCULATED) { return; }
+			traced[pixel] |= TRACE_CALCULATED;
+			points.cx[count] = left + ((pixel / height) * (right - left) / width);
+			points.cy[count] = top + ((pixel % height) * (bottom - top) / height);
+			points.pixel[count] = pixel;
+			if (++count == capacity) { flush(); }
+		};
+		// neighbours of a pixel inside the region - returns how many there are
+		auto neighbours = [=](unsigned pixel, unsigned * around)
+		{
+			const unsigned x = pixel / height;
+			const unsigned y = pixel % height;
+			unsigned n = 0;
+			if (x > x0) { around[n++] = pixel - height; }
+			if (x + 1 < x1) { around[n++] = pixel + height; }
+			if (y > y0) { around[n++] = pixel - 1; }
+			if (y + 1 < y1) { around[n++] = pixel + 1; }
+			return n;
+		};
+		std::vector<unsigned>& wave = points.wave;
+		std::vector<unsigned>& next_wave = points.next_wave;
+		auto trace = [&](unsigned pixel)
+		{
+			if (traced[pixel] & TRACE_QUEUED) { return; }
+			traced[pixel] |= TRACE_QUEUED;
+			next_wave.push_back(pixel);
+		};
+
+		// the tracing starts from the edges of the region
+		next_wave.clear();
+		for (unsigned x = x0; x < x1; ++x)
+		{
+			trace(x * height + y0);
+			trace(x * height + y1 - 1);
+		}
+		for (unsigned y = y0 + 1; y + 1 < y1; ++y)
+		{
+			trace(x0 * height + y);
+			trace((x1 - 1) * height + y);
+		}
+		unsigned around[4];
+		auto trace_waves = [&]()
+		{
+			while (!next_wave.empty())
+			{
+				wave.swap(next_wave);
+				next_wave.clear();
+				for (unsigned pixel : wave)
+				{
+					calculate(pixel);
+					const unsigned n = neighbours(pixel, around);
+					for (unsigned i = 0; i < n; ++i)
+					{
+						calculate(around[i]);
+					}
+				}
+				flush();
+				// a pixel with a neighbour of another count is on the edge of a band, both sides of it are traced
+				for (unsigned pixel : wave)
+				{
+					const unsigned n = neighbours(pixel, around);
+					bool edge = false;
+					for (unsigned i = 0; i < n && !edge; ++i)
+					{
+						edge = counts[around[i]] != counts[pixel];
+					}
+					if (!edge) { continue; }
+					for (unsigned i = 0; i < n; ++i)
+					{
+						trace(around[i]);
+					}
+				}
+			}
+		};
+		trace_waves();
+		// a band or a speck of the set inside the region may not reach any pixel traced from its edges -
+		// its middle column and row are calculated too, and traced from wherever they change count
+		if (verify_fills)
+		{
+			const unsigned middle_x = (x0 + x1) / 2;
+			const unsigned middle_y = (y0 + y1) / 2;
+			for (unsigned y = y0 + 1; y + 1 < y1; ++y)
+			{
+				calculate(middle_x * height + y);
+			}
+			for (unsigned x = x0 + 1; x + 1 < x1; ++x)
+			{
+				calculate(x * height + middle_y);
+			}
+			flush();
+			for (unsigned y = y0 + 1; y < y1; ++y)
+			{
+				const unsigned pixel = middle_x * height + y;
+				if (counts[pixel] == counts[pixel - 1]) { continue; }
+				trace(pixel);
+				trace(pixel - 1);
+			}
+			for (unsigned x = x0 + 1; x < x1; ++x)
+			{
+				const unsigned pixel = x * height + middle_y;
+				if (counts[pixel] == counts[pixel - height]) { continue; }
+				trace(pixel);
+				trace(pixel - height);
+			}
+			trace_waves();
+		}
+
+		// the pixels left are enclosed by pixels of one count - the top edge of the region is known
+		for (unsigned x = x0; x < x1; ++x)
+		{
+			unsigned * column = counts + std::size_t(x) * height;
+			for (unsigned y = y0 + 1; y < y1; ++y)
+			{
+				if (column[y] == PIXEL_PENDING)
+				{
+					column[y] = column[y - 1];
+					++points.pixels_filled;
+				}
+			}
+			std::copy(column + y0, column + y1, iterations + std::size_t(x) * height + y0);
+		}
+	};
+	pool_->run(regions_x * regions_y, trace_region);
+	const unsigned steals = pool_->stats().steals;
+	const double idle_ms = pool_->stats().idle_ms;
+	auto end = std::chrono::steady_clock::now();
+	const unsigned regions_skipped = record_timing(std::chrono::duration<double, std::milli>(end - start).count(),
+		regions_x * regions_y, steals, idle_ms);
+	return regions_skipped == 0;
+}
+
+bool CpuEngine::render_refined(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	const CancelToken& cancel, FrameProgress * progress)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const bool guess = refine_guess_;
+	const unsigned capacity = tile_size_ * tile_size_;
+	TileScratch * scratch = scratch_.data();
+	ensure_pending_state();
+	unsigned * counts = counts_.data();
+	reset_scratch();
+
+	auto start = std::chrono::steady_clock::now();
+	// the points of a column are batched in the scratch buffers
+	auto flush = [=](TileScratch& points, unsigned& count)
+	{
+		flush_points(points, count, max_iter);
+		count = 0;
+	};
+	// count of a pixel, PIXEL_PENDING outside the frame
+	auto known = [=](unsigned x, unsigned y)
+	{
+		return x < width && y < height ? counts[std::size_t(x) * height + y] : PIXEL_PENDING;
+	};
+
+	unsigned passes = 0;
+	unsigned steals = 0;
+	double idle_ms = 0.0;
+	double first_pass_ms = 0.0;
+	bool stopped = false;
+	for (unsigned step = REFINE_START; ; step /= 2)
+	{
+		// the first pass calculates its whole grid, the others the centres and then the midpoints of the sides
+		// of the squares of the last pass's grid (the midpoints are guessed from the centres)
+		const unsigned first_phase = step == REFINE_START ? 0 : 1;
+		const unsigned last_phase = step == REFINE_START ? 0 : 2;
+		for (unsigned phase = first_phase; phase <= last_phase; ++phase)
+		{
+			pool_->run(width, [=](unsigned x, unsigned worker)
+			{
+				TileScratch& points = scratch[worker];
+				if (cancel.cancelled())
+				{
+					++points.tiles_skipped;
+					return;
+				}
+				const unsigned span = step * 2;
+				unsigned first_y, step_y;
+				if (phase == 0)
+				{
+					std::fill(counts + std::size_t(x) * height, counts + std::size_t(x) * height + height, PIXEL_PENDING);
+					if (x % step != 0) { return; }
+					first_y = 0;
+					step_y = step;
+				}
+				else if (phase == 1)
+				{
+					if (x % span != step) { return; }
+					first_y = step;
+					step_y = span;
+				}
+				else
+				{
+					if (x % step != 0) { return; }
+					// the midpoints of the vertical sides on the columns of the last grid, of the horizontal ones between them
+					first_y = x % span == 0 ? step : 0;
+					step_y = span;
+				}
+				const bool vertical = x % span == 0;
+				unsigned count = 0;
+				for (unsigned y = first_y; y < height; y += step_y)
+				{
+					const std::size_t pixel = std::size_t(x) * height + y;
+					if (phase == 2 && guess)
+					{
+						// the ends of the side and the centres of the squares either side of it
+						const unsigned end0 = vertical ? known(x, y - step) : known(x - step, y);
+						const unsigned end1 = vertical ? known(x, y + step) : known(x + step, y);
+						const unsigned centre0 = vertical ? known(x - step, y) : known(x, y - step);
+						const unsigned centre1 = vertical ? known(x + step, y) : known(x, y + step);
+						if (end0 != PIXEL_PENDING && end0 == end1)
+						{
+							if (centre0 == end0 && centre1 == end0)
+							{
+								counts[pixel] = end0;
+								++points.pixels_filled;
+								continue;
+							}
+							++points.guesses_rejected;
+						}
+					}
+					points.cx[count] = left + (x * (right - left) / width);
+					points.cy[count] = top + (y * (bottom - top) / height);
+					points.pixel[count] = unsigned(pixel);
+					if (++count == capacity) { flush(points, count); }
+				}
+				flush(points, count);
+			});
+			steals += pool_->stats().steals;
+			idle_ms += pool_->stats().idle_ms;
+		}
+		++passes;
+		if (cancel.cancelled())
+		{
+			stopped = true;
+			break;
+		}
+		if (step == REFINE_START)
+		{
+			first_pass_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		if (step == 1) { break; }
+		if (progress != nullptr)
+		{
+			// every pixel shows the calculated pixel above and to the left of it
+			pool_->run(width, [=](unsigned x, unsigned /*worker*/)
+			{
+				const uint32_t * column = counts + std::size_t(x - x % step) * height;
+				uint32_t * target = iterations + std::size_t(x) * height;
+				for (unsigned y = 0; y < height; ++y)
+				{
+					target[y] = column[y - y % step];
+				}
+			});
+			const unsigned known_x = (width + step - 1) / step;
+			const unsigned known_y = (height + step - 1) / step;
+			progress->frame_progress(known_x * known_y, width * height);
+		}
+	}
+	if (!stopped)
+	{
+		std::copy(counts_.begin(), counts_.end(), iterations);
+	}
+	auto end = std::chrono::steady_clock::now();
+	record_timing(std::chrono::duration<double, std::milli>(end - start).count(), passes, steals, idle_ms);
+	timing_.first_pass_ms = first_pass_ms;
+	return !stopped;
+}
+
+bool CpuEngine::render_sliced(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+	const CancelToken& cancel, FrameProgress * progress)
+{
+	const unsigned width = width_;
+	const unsigned height = height_;
+	const unsigned pixels = width * height;
+	const double bailout = double(escape_radius_) * escape_radius_;
+	const EscapeKernelFunction kernel = kernel_;
+	const bool interior_checks = interior_checks_;
+	TileScratch * scratch = scratch_.data();
+	// the resume state isn't kept
+	state_valid_ = false;
+	if (active_pixel_.size() != pixels)
+	{
+		active_cx_.resize(pixels);
+		active_cy_.resize(pixels);
+		active_zx_.resize(pixels);
+		active_zy_.resize(pixels);
+		active_iterations_.resize(pixels);
+		active_pixel_.resize(pixels);
+	}
+	double * cx = active_cx_.data();
+	double * cy = active_cy_.data();
+	double * zx = active_zx_.data();
+	double * zy = active_zy_.data();
+	unsigned * counts = active_iterations_.data();
+	unsigned * pixel = active_pixel_.data();
+	reset_scratch();
+
+	auto start = std::chrono::steady_clock::now();
+	// every pixel starts out active and is drawn as part of the set until it escapes
+	pool_->run(width, [=](unsigned x, unsigned /*worker*/)
+	{
+		const double column_x = left + (x * (right - left) / width);
+		for (unsigned y = 0; y < height; ++y)
+		{
+			const unsigned i = x * height + y;
+			cx[i] = column_x;
+			cy[i] = top + (y * (bottom - top) / height);
+			zx[i] = 0.0f;
+			zy[i] = 0.0f;
+			counts[i] = 0;
+			pixel[i] = i;
+			iterations[i] = max_iter;
+		}
+	});
+
+	unsigned active = pixels;
+	unsigned slice = SLICE_ITERATIONS;
+	unsigned round_end = 0;
+	unsigned rounds = 0;
+	unsigned first_round_active = 0;
+	unsigned steals = 0;
+	double idle_ms = 0.0;
+	bool stopped = false;
+	while (active > 0)
+	{
+		round_end = max_iter - round_end > slice ? round_end + slice : max_iter;
+		slice *= 2;
+		const bool first_round = rounds == 0;
+		const unsigned chunks = (active + SLICE_CHUNK - 1) / SLICE_CHUNK;
+		chunk_active_.resize(chunks);
+		unsigned * chunk_active = chunk_active_.data();
+		pool_->run(chunks, [=](unsigned chunk, unsigned worker)
+		{
+			TileScratch& points = scratch[worker];
+			chunk_active[chunk] = 0;
+			// a newer frame was requested - skip the rest of the round
+			if (cancel.cancelled())
+			{
+				++points.tiles_skipped;
+				return;
+			}
+			const unsigned first = chunk * SLICE_CHUNK;
+			const unsigned count = active - first < SLICE_CHUNK ? active - first : SLICE_CHUNK;
+			if (first_round)
+			{
+				// points in the main cardioid or the period-2 bulb would stay active in every round
+				unsigned interior = 0;
+				if (interior_checks)
+				{
+					for (unsigned i = first; i < first + count; ++i)
+					{
+						if (!in_cardioid_or_bulb(cx[i], cy[i])) { continue; }
+						counts[i] = max_iter;
+						++interior;
+					}
+					points.interior.cardioid_points += interior;
+					points.interior.cardioid_iterations += (unsigned long long)interior * max_iter;
+				}
+				points.pixels_iterated += count - interior;
+			}
+			kernel(EscapeJob{ cx + first, cy + first, counts + first, count, round_end, bailout,
+				zx + first, zy + first, interior_checks ? &points.interior : nullptr });
+			// the escaped points are drawn, the rest move to the front of the chunk
+			unsigned kept = first;
+			for (unsigned i = first; i < first + count; ++i)
+			{
+				const unsigned n = counts[i];
+				if (n < round_end) { iterations[pixel[i]] = n; }
+				if (n < round_end || n >= max_iter) { continue; }
+				if (i != kept)
+				{
+					cx[kept] = cx[i];
+					cy[kept] = cy[i];
+					zx[kept] = zx[i];
+					zy[kept] = zy[i];
+					counts[kept] = n;
+					pixel[kept] = pixel[i];
+				}
+				++kept;
+			}
+			chunk_active[chunk] = kept - first;
+		});
+		steals += pool_->stats().steals;
+		idle_ms += pool_->stats().idle_ms;
+		++rounds;
+		if (cancel.cancelled())
+		{
+			stopped = true;
+			break;
+		}
+		// close the gaps between the chunks
+		unsigned next = chunk_active[0];
+		for (unsigned chunk = 1; chunk < chunks; ++chunk)
+		{
+			const unsigned first = chunk * SLICE_CHUNK;
+			const unsigned kept = chunk_active[chunk];
+			if (next == first)
+			{
+				next += kept;
+				continue;
+			}
+			std::memmove(cx + next, cx + first, kept * sizeof(double));
+			std::memmove(cy + next, cy + first, kept * sizeof(double));
+			std::memmove(zx + next, zx + first, kept * sizeof(double));
+			std::memmove(zy + next, zy + first, kept * sizeof(double));
+			std::memmove(counts + next, counts + first, kept * sizeof(unsigned));
+			std::memmove(pixel + next, pixel + first, kept * sizeof(unsigned));
+			next += kept;
+		}
+		active = next;
+		if (first_round) { first_round_active = active; }
+		if (progress != nullptr && active > 0)
+		{
+			progress->frame_progress(pixels - active, pixels);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	record_timing(std::chrono::duration<double, std::milli>(end - start).count(), rounds, steals, idle_ms);
+	timing_.first_round_active = first_round_active;
+	return !stopped;
+}
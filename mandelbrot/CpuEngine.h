@@ -0,0 +1,289 @@
+// CpuEngine class
+// Multithreaded tiled CPU renderer for the Mandelbrot set.
+// The frame is split into tile_size x tile_size tiles (like the TILE_SIZE tiles of the C++ AMP kernels)
+// that are spread across a persistent pool of worker threads.
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "ThreadPool.h"
+#include "EscapeKernel.h"
+#include "CancelToken.h"
+#include "Frame.h"
+#include "TileCache.h"
+
+// how the engine calculates a frame
+enum RENDER_MODE
+{
+	MODE_TILES,      // every pixel, tile by tile
+	MODE_SUBDIVIDE,  // Mariani-Silver: only the borders of rectangles, a uniform border is filled without iterating inside
+	MODE_BOUNDARY,   // boundary tracing: only the pixels next to a change of count, the areas they enclose are filled
+	MODE_REFINE,     // successive refinement: every 16th pixel first, then every 8th, 4th, 2nd and the rest
+	MODE_SLICED,     // every pixel in rounds of iterations, only the ones still active go on to the next round
+	RENDER_MODE_COUNT,
+};
+
+inline const char * mode_name(RENDER_MODE mode)
+{
+	switch (mode)
+	{
+	case MODE_TILES: return "tiles";
+	case MODE_SUBDIVIDE: return "subdivide";
+	case MODE_BOUNDARY: return "boundary";
+	case MODE_REFINE: return "refine";
+	case MODE_SLICED: return "sliced";
+	default: return "unknown";
+	}
+}
+
+// timings of the last rendered frame
+struct FrameTiming
+{
+	double milliseconds;          // wall clock time of the whole frame
+	unsigned threads;             // number of worker threads used
+	unsigned tiles;               // number of tiles the frame was split into (rectangles in MODE_SUBDIVIDE, regions in MODE_BOUNDARY,
+	                              // passes in MODE_REFINE, rounds in MODE_SLICED)
+	double megapixels_per_second; // throughput
+	KERNEL_ISA isa;               // instruction set of the escape-time kernel
+	KERNEL_PRECISION precision;   // double or float
+	SCHEDULE schedule;            // how the tiles were spread across the workers
+	unsigned steals;              // tiles ranges stolen by idle workers
+	double idle_ms;               // time workers spent waiting for the last one to finish
+	unsigned pixels_iterated;     // pixels the escape-time kernel ran on (the rest came from the previous frame)
+	InteriorStats interior;       // work saved by the interior checks
+	RENDER_MODE mode;
+	unsigned pixels_filled;       // pixels given the count of the pixels around them without iterating them
+	unsigned rects_rejected;      // MODE_SUBDIVIDE: uniform rectangles split anyway because a point checked inside them differed
+	unsigned guesses_rejected;    // MODE_REFINE: pixels iterated because a centre around them differed from the rest
+	double first_pass_ms;         // MODE_REFINE: time until the first pass could be shown
+	unsigned first_round_active;  // MODE_SLICED: pixels still active after the first round
+	double focus_ms;              // MODE_TILES: time until the tile of the focus pixel was calculated
+};
+
+class CpuEngine
+{
+public:
+	// thread_count == 0 uses every hardware thread (the pool shared by the whole process)
+	CpuEngine(unsigned tile_size, unsigned thread_count = 0);
+	// size of the frames to render (the state kept for resuming is dropped and the focus moves to the centre when it changes)
+	void set_size(unsigned width, unsigned height);
+	unsigned width() const { return width_; }
+	unsigned height() const { return height_; }
+	// give back the iteration state kept for resuming and the tile cache (allocated again by the next render)
+	void release_state();
+	// a point escaped once |z| reached the escape radius
+	void set_escape_radius(float escape_radius);
+	float escape_radius() const { return escape_radius_; }
+	// switch to a worker pool with a different number of threads (0 - the shared pool)
+	void set_thread_count(unsigned thread_count);
+	unsigned thread_count() const { return pool_->size(); }
+	// escape-time kernel instruction set (limited to what the CPU supports)
+	void set_isa(KERNEL_ISA isa);
+	KERNEL_ISA isa() const { return isa_; }
+	// iterate in double (the default) or in float - twice as many points per instruction,
+	// but neighbouring pixels merge once the frame is less than about 1e-4 across
+	void set_precision(KERNEL_PRECISION precision);
+	KERNEL_PRECISION precision() const { return precision_; }
+	// skip the points inside the main cardioid and the period-2 bulb and stop at repeating orbits (on by default)
+	void set_interior_checks(bool enabled) { interior_checks_ = enabled; }
+	bool interior_checks() const { return interior_checks_; }
+	// tiles (the default), subdivision, boundary tracing, successive refinement or iteration slices
+	// (the tile cache takes precedence over all of them)
+	void set_mode(RENDER_MODE mode) { mode_ = mode; }
+	RENDER_MODE mode() const { return mode_; }
+	// MODE_SUBDIVIDE iterates the middle row and column and a few more points inside a rectangle with a uniform border
+	// before filling it, MODE_BOUNDARY the middle row and column of every region (on by default)
+	void set_verify_fills(bool enabled) { verify_fills_ = enabled; }
+	bool verify_fills() const { return verify_fills_; }
+	// MODE_REFINE takes the count of a pixel from the four pixels around it when they agree (off by default)
+	void set_refine_guess(bool enabled) { refine_guess_ = enabled; }
+	bool refine_guess() const { return refine_guess_; }
+	// static split or work stealing (the default)
+	void set_schedule(SCHEDULE schedule) { schedule_ = schedule; pool_->set_schedule(schedule); }
+	SCHEDULE schedule() const { return schedule_; }
+	// pixel the user looks at - with focus_first (the default) the tiles nearest to it are calculated first,
+	// row by row without it. The time until its tile was calculated is recorded either way.
+	void set_focus(unsigned x, unsigned y, bool focus_first);
+	unsigned focus_x() const { return focus_x_; }
+	unsigned focus_y() const { return focus_y_; }
+	bool focus_first() const { return focus_first_; }
+	// per worker statistics of the last frame
+	const PoolStats& pool_stats() const { return pool_->stats(); }
+	// assemble the frames from a TileCache of escape counts on a quadtree grid of the complex plane,
+	// calculating only the tiles missing from it (off by default, switching it off empties the cache)
+	void set_tile_cache(bool enabled);
+	bool tile_cache_enabled() const { return tile_cache_enabled_; }
+	const TileCache& tile_cache() const { return tile_cache_; }
+	void set_tile_cache_budget(std::size_t bytes) { tile_cache_.set_budget(bytes); }
+	// Render the escape count of every pixel into the iterations array.
+	// The counts are stored column by column (iterations[x * height + y]), the same layout amp_mandelbrot produces.
+	// With resume set and the same region as the last frame, a higher max_iter only continues
+	// the pixels that hadn't escaped and a lower one is derived from the stored counts.
+	// A region panned by a whole number of pixels (same size) shifts the stored state
+	// and only calculates the rows and columns that came into view (and continues the others for a higher max_iter).
+	// The set is symmetric about the real axis: the rows of a region straddling it whose c_y is exactly the
+	// negated c_y of a row on the other side are copied from that row instead of iterated.
+	// The tiles are calculated nearest to the focus pixel (the centre of the frame by default) first. With progress set, a frame that can't
+	// be resumed starts from the last frame reprojected onto the new region and is reported in PROGRESS_PARTS parts.
+	// MODE_REFINE reports every pass but the last one to progress, the pixels not calculated yet copied from the
+	// nearest calculated pixel above and to the left of them. MODE_SLICED reports every round but the last one with the
+	// pixels still active drawn with a count of max_iter.
+	// Returns false if cancel was set before all the tiles were calculated (the remaining tiles are skipped).
+	bool render(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		bool resume = true, const CancelToken& cancel = CancelToken(), FrameProgress * progress = nullptr);
+	const FrameTiming& timing() const { return timing_; }
+private:
+	unsigned width_;
+	unsigned height_;
+	float escape_radius_;
+	unsigned tile_size_;
+	// ThreadPool::shared() or own_pool_, the workers of an engine with a thread count of its own
+	ThreadPool * pool_;
+	std::unique_ptr<ThreadPool> own_pool_;
+	FrameTiming timing_;
+	// best instruction set of this CPU, chosen at startup
+	KERNEL_ISA best_isa_;
+	KERNEL_ISA isa_;
+	KERNEL_PRECISION precision_;
+	EscapeKernelFunction kernel_;
+	SCHEDULE schedule_;
+	bool interior_checks_;
+	RENDER_MODE mode_;
+	bool verify_fills_;
+	bool refine_guess_;
+	// rectangle of MODE_SUBDIVIDE, the border included (x1 and y1 are its last column and row)
+	struct Rect
+	{
+		unsigned x0, y0, x1, y1;
+		bool checked; // uniform, the points checked inside it were queued in the last round
+	};
+	// per worker buffers holding the points of the tile being calculated
+	struct TileScratch
+	{
+		std::vector<double> cx;
+		std::vector<double> cy;
+		std::vector<double> zx;
+		std::vector<double> zy;
+		std::vector<unsigned> iterations;
+		std::vector<unsigned> pixel; // index of the point in the frame
+		unsigned pixels_iterated;
+		unsigned tiles_skipped;      // tiles not calculated because the frame was cancelled
+		InteriorStats interior;
+		unsigned pixels_filled;
+		unsigned rects_rejected;
+		unsigned guesses_rejected;
+		std::vector<Rect> rects;     // rectangles split off for the next round of MODE_SUBDIVIDE
+		unsigned queued;             // points of MODE_SUBDIVIDE waiting in the buffers above
+		std::vector<unsigned> wave;  // pixels MODE_BOUNDARY is tracing from and the ones it traces next
+		std::vector<unsigned> next_wave;
+	};
+	std::vector<TileScratch> scratch_;
+	void allocate_scratch();
+	// zero the per frame counters of the workers
+	void reset_scratch();
+	// set up counts_ for a mode that marks the pixels it hasn't calculated yet PIXEL_PENDING
+	void ensure_pending_state();
+	// iterate the first count points in the scratch buffers of a worker into counts_
+	void flush_points(TileScratch& points, unsigned count, unsigned max_iter);
+	// wall clock time and throughput of the frame - returns the number of tiles skipped by a cancelled frame
+	unsigned record_timing(double milliseconds, unsigned tiles, unsigned steals, double idle_ms);
+	// drop the iteration state kept for resuming (the tile cache is kept)
+	void release_resume_state();
+	// pixel offset of the region from the stored one - false unless it is a pan by whole pixels
+	bool pan_offset(double left, double right, double top, double bottom, int& dx, int& dy) const;
+	// move the stored state by (dx, dy) pixels, the pixels that came into view are marked PIXEL_PENDING
+	void shift_state(int dx, int dy);
+	// row the frame is mirrored around (rows y and mirror - y are complex conjugates), -1 if the rows don't line up
+	int mirror_row(double top, double bottom) const;
+	// rows of the frame copied from their partner (their c_y is exactly the negated c_y of row mirror - y)
+	std::vector<unsigned char> mirrored_rows_;
+	// fill iterations with the stored counts of the last frame resampled onto the new region
+	void reproject_state(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter);
+	unsigned focus_x_, focus_y_;
+	bool focus_first_;
+	// tiles sorted by their distance from the focus pixel, or row by row
+	// (built on the first render at a new size or after the focus moved to another tile)
+	std::vector<unsigned> tile_order_;
+	unsigned order_focus_tile_;
+	void order_tiles(unsigned tiles_x, unsigned tiles_y, unsigned focus_tile);
+	// position of every tile in tile_order_
+	std::vector<unsigned> tile_rank_;
+	// number of parts a progressive frame is calculated in
+	static const unsigned PROGRESS_PARTS = 4;
+	// iteration state of every pixel of the last frame (allocated on the first render at a new size)
+	// z is where every pixel stopped - a pixel whose z didn't escape was stopped at its count (the max_iter of the
+	// frame it was calculated in, which can be higher or lower than state_max_iter_ after a pan)
+	std::vector<unsigned> counts_;
+	std::vector<double> zx_;
+	std::vector<double> zy_;
+	// count of a pixel that still has to be calculated from z = 0
+	static const unsigned PIXEL_PENDING = 0xFFFFFFFF;
+	bool state_valid_;
+	double state_left_, state_right_, state_top_, state_bottom_;
+	unsigned state_max_iter_; // max_iter of the last frame
+	// render() with the tile cache on - every pixel shows the nearest point of the finest cache level
+	// at least as fine as the frame (so a frame calculates at most four times its pixels when nothing is cached)
+	bool render_cached(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		bool resume, const CancelToken& cancel);
+	bool tile_cache_enabled_;
+	TileCache tile_cache_;
+	// cache tiles covering the frame being assembled
+	struct CachedTile
+	{
+		TileCache::Key key;
+		const uint32_t * counts; // found in the cache or being calculated into
+		bool missing;
+		double cost;             // iterations it took to calculate
+	};
+	std::vector<CachedTile> cached_tiles_;
+	std::vector<unsigned> missing_tiles_;
+	// cache tile row (times TileCache::TILE) plus the point in it of every row of the frame
+	std::vector<unsigned> cached_rows_;
+	// render() in MODE_SUBDIVIDE - the frame starts as SUBDIVIDE_START x SUBDIVIDE_START rectangles whose borders are
+	// calculated. A rectangle with a uniform border is filled with its count, any other one calculates its middle row
+	// and column and is split into four for the next round. A fill is an approximation: a speck or a filament of
+	// another count passing between the pixels of the border (and of the checks) is filled over. Each round runs the rectangles on the worker pool,
+	// the points they need are queued and iterated in full batches at the end of the round.
+	// Rectangles less than SUBDIVIDE_MIN_SIZE pixels across are calculated point by point.
+	bool render_subdivided(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		const CancelToken& cancel);
+	static const unsigned SUBDIVIDE_START = 64;
+	static const unsigned SUBDIVIDE_MIN_SIZE = 6;
+	// rectangles of the current round
+	std::vector<Rect> rects_;
+	// render() in MODE_BOUNDARY - the frame is split into BOUNDARY_REGION x BOUNDARY_REGION regions traced by the
+	// worker threads. A region calculates its edges, then in waves the neighbours of the pixels traced so far;
+	// the neighbours of a pixel with a neighbour of another count are traced in the next wave. Once no pixel
+	// is left to trace, the rest of the region is enclosed by pixels of one count and filled down its columns
+	// (an approximation like MODE_SUBDIVIDE's fills - a speck not reached by the tracing is filled over).
+	bool render_traced(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		const CancelToken& cancel);
+	static const unsigned BOUNDARY_REGION = 64;
+	// what MODE_BOUNDARY did with every pixel (allocated on the first traced frame at a new size)
+	enum { TRACE_CALCULATED = 1, TRACE_QUEUED = 2 };
+	std::vector<unsigned char> traced_;
+	// render() in MODE_REFINE - the first pass calculates every REFINE_START-th pixel of every REFINE_START-th row,
+	// every pass after it halves the spacing. A pass calculates the centres of the squares of the last pass's grid
+	// first and then the midpoints of their sides, which are guessed from the ends of the side and the centres
+	// either side of it when the guess is on (the centres, a third of the pixels of the pass, are always iterated).
+	bool render_refined(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		const CancelToken& cancel, FrameProgress * progress);
+	static const unsigned REFINE_START = 16;
+	// render() in MODE_SLICED - every pixel is iterated SLICE_ITERATIONS iterations in the first round, twice as
+	// many as the round before in the others. The pixels that haven't escaped are kept in a dense list, which is
+	// compacted after every round, so the late rounds only run the few pixels still active, from contiguous memory. A round runs the list in SLICE_CHUNK point
+	// chunks on the worker pool; each chunk moves its active points to its front, the gaps are closed afterwards.
+	bool render_sliced(uint32_t * iterations, double left, double right, double top, double bottom, unsigned max_iter,
+		const CancelToken& cancel, FrameProgress * progress);
+	static const unsigned SLICE_ITERATIONS = 64;
+	static const unsigned SLICE_CHUNK = 4096;
+	// the pixels still active (allocated on the first sliced frame at a new size)
+	std::vector<double> active_cx_;
+	std::vector<double> active_cy_;
+	std::vector<double> active_zx_;
+	std::vector<double> active_zy_;
+	std::vector<unsigned> active_iterations_;
+	std::vector<unsigned> active_pixel_;
+	// active points left at the front of every chunk
+	std::vector<unsigned> chunk_active_;
+};
@@ -0,0 +1,195 @@
+#include "EscapeKernel.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(ESCAPE_KERNEL_X86)
+#include <cpuid.h>
+#endif
+
+// Real - double or float, the type the point is iterated in
+template <class Real>
+static void escape_kernel_scalar_real(const EscapeJob& job, Real epsilon)
+{
+	const Real epsilon2 = epsilon * epsilon;
+	const Real bailout = Real(job.bailout);
+	for (unsigned i = 0; i < job.count; ++i)
+	{
+		const Real cx = Real(job.cx[i]);
+		const Real cy = Real(job.cy[i]);
+		// Iterate z = z^2 + c until z moves further than the escape radius
+		// away from (0, 0), or we've iterated too many times.
+		Real zx = 0, zy = 0;
+		unsigned iterations = 0;
+		// resume from where the point stopped last time
+		if (job.zx)
+		{
+			zx = Real(job.zx[i]);
+			zy = Real(job.zy[i]);
+			iterations = job.iterations[i];
+		}
+		if (job.interior && iterations < job.max_iter && in_cardioid_or_bulb(job.cx[i], job.cy[i]))
+		{
+			++job.interior->cardioid_points;
+			job.interior->cardioid_iterations += job.max_iter - iterations;
+			iterations = job.max_iter;
+		}
+		// z at the last checkpoint of the cycle detection
+		Real saved_x = zx, saved_y = zy;
+		unsigned interval = 1;
+		unsigned checkpoint = iterations + interval;
+		while (zx * zx + zy * zy < bailout && iterations < job.max_iter)
+		{
+			const Real t = zx * zx - zy * zy + cx;
+			zy = 2 * zx * zy + cy;
+			zx = t;
+			++iterations;
+			if (!job.interior) { continue; }
+			const Real dx = zx - saved_x;
+			const Real dy = zy - saved_y;
+			if (dx * dx + dy * dy < epsilon2)
+			{
+				// the orbit repeats - the point never escapes
+				++job.interior->periodic_points;
+				job.interior->periodic_iterations += job.max_iter - iterations;
+				iterations = job.max_iter;
+				break;
+			}
+			if (iterations == checkpoint)
+			{
+				saved_x = zx;
+				saved_y = zy;
+				if (interval < PERIODICITY_MAX_INTERVAL) { interval *= 2; }
+				checkpoint = iterations + interval;
+			}
+		}
+		job.iterations[i] = iterations;
+		if (job.zx)
+		{
+			job.zx[i] = zx;
+			job.zy[i] = zy;
+		}
+	}
+}
+
+void escape_kernel_scalar(const EscapeJob& job)
+{
+	escape_kernel_scalar_real<double>(job, PERIODICITY_EPSILON_DOUBLE);
+}
+
+void escape_kernel_scalar_float(const EscapeJob& job)
+{
+	escape_kernel_scalar_real<float>(job, PERIODICITY_EPSILON);
+}
+
+#ifdef ESCAPE_KERNEL_X86
+// cpuid leaf / subleaf into regs (eax, ebx, ecx, edx)
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4])
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	for (int i = 0; i < 4; ++i) { regs[i] = (unsigned)r[i]; }
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// register state the operating system saves on a context switch (XCR0)
+static unsigned long long xgetbv0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+KERNEL_ISA detect_isa()
+{
+#ifdef ESCAPE_KERNEL_X86
+	unsigned regs[4];
+	cpuid(0, 0, regs);
+	const unsigned max_leaf = regs[0];
+	cpuid(1, 0, regs);
+	const bool sse2 = (regs[3] & (1u << 26)) != 0;
+	const bool osxsave = (regs[2] & (1u << 27)) != 0;
+	const bool avx = (regs[2] & (1u << 28)) != 0;
+	if (!sse2) { return ISA_SCALAR; }
+	if (!osxsave || !avx || max_leaf < 7) { return ISA_SSE2; }
+
+	const unsigned long long xcr0 = xgetbv0();
+	// the OS has to save the XMM and YMM registers for AVX and also the opmask and ZMM registers for AVX-512
+	const bool os_avx = (xcr0 & 0x06) == 0x06;
+	const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+	cpuid(7, 0, regs);
+	const bool avx2 = (regs[1] & (1u << 5)) != 0;
+	const bool avx512f = (regs[1] & (1u << 16)) != 0;
+#ifdef ESCAPE_KERNEL_AVX512
+	if (avx512f && os_avx512) { return ISA_AVX512; }
+#endif
+	if (avx2 && os_avx) { return ISA_AVX2; }
+	return ISA_SSE2;
+#else
+	return ISA_SCALAR;
+#endif
+}
+
+bool detect_ssse3()
+{
+#ifdef ESCAPE_KERNEL_X86
+	unsigned regs[4];
+	cpuid(1, 0, regs);
+	return (regs[2] & (1u << 9)) != 0;
+#else
+	return false;
+#endif
+}
+
+EscapeKernelFunction escape_kernel(KERNEL_ISA isa, KERNEL_PRECISION precision)
+{
+	const bool single = precision == PRECISION_FLOAT;
+	switch (isa)
+	{
+#ifdef ESCAPE_KERNEL_X86
+#ifdef ESCAPE_KERNEL_AVX512
+	case ISA_AVX512: return single ? escape_kernel_avx512_float : escape_kernel_avx512;
+#else
+	case ISA_AVX512:
+#endif
+	case ISA_AVX2: return single ? escape_kernel_avx2_float : escape_kernel_avx2;
+	case ISA_SSE2: return single ? escape_kernel_sse2_float : escape_kernel_sse2;
+#endif
+	default: return single ? escape_kernel_scalar_float : escape_kernel_scalar;
+	}
+}
+
+const char * isa_name(KERNEL_ISA isa)
+{
+	switch (isa)
+	{
+	case ISA_SSE2: return "SSE2";
+	case ISA_AVX2: return "AVX2";
+	case ISA_AVX512: return "AVX-512";
+	default: return "scalar";
+	}
+}
+
+const char * precision_name(KERNEL_PRECISION precision)
+{
+	return precision == PRECISION_FLOAT ? "float" : "double";
+}
+
+unsigned isa_lanes(KERNEL_ISA isa, KERNEL_PRECISION precision)
+{
+	// a vector holds twice as many floats as doubles
+	const unsigned floats = precision == PRECISION_FLOAT ? 2 : 1;
+	switch (isa)
+	{
+	case ISA_SSE2: return 2 * floats;
+	case ISA_AVX2: return 4 * floats;
+	case ISA_AVX512: return 8 * floats;
+	default: return 1;
+	}
+}
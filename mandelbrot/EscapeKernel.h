@@ -0,0 +1,105 @@
+// Escape-time kernels
+// Scalar and SIMD (SSE2, AVX2, AVX-512) versions of the
+// "iterate z = z^2 + c until |z| >= 2 or max_iter" loop, in double precision and in float as a faster option.
+// The SIMD kernels iterate 2/4/8 points (4/8/16 in float) at once, compare |z|^2 against the squared escape radius instead of calling sqrt
+// and only test for escape every ESCAPE_CHECK_INTERVAL iterations. When a lane escapes
+// it is refilled with the next pending point, so one slow point does not idle the whole vector.
+// The instruction set is chosen once at startup with CPUID.
+#pragma once
+
+// number of iterations the SIMD kernels run between two escape tests
+#define ESCAPE_CHECK_INTERVAL 8
+
+// Interior checks: points in the main cardioid or the period-2 bulb are never iterated, and a point whose orbit
+// comes back to where it was at the last checkpoint (Brent's cycle detection, the checkpoints getting further apart
+// up to PERIODICITY_MAX_INTERVAL iterations) is taken to be in the set without iterating it to max_iter.
+// The orbit has to come back to within a few ulps of |z| ~ 1 - a looser tolerance would catch boundary
+// points that escape after many iterations.
+#define PERIODICITY_EPSILON (8.0f * 1.1920929e-7f)
+#define PERIODICITY_EPSILON_DOUBLE (8.0 * 2.220446049250313e-16)
+#define PERIODICITY_MAX_INTERVAL 512
+
+// SIMD kernels are only built for x86 (other hosts use the scalar kernel)
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define ESCAPE_KERNEL_X86
+// AVX-512 intrinsics need Visual Studio 2017 15.3 (or GCC/Clang)
+#if !defined(_MSC_VER) || _MSC_VER >= 1911
+#define ESCAPE_KERNEL_AVX512
+#endif
+#endif
+
+enum KERNEL_ISA
+{
+	ISA_SCALAR,
+	ISA_SSE2,
+	ISA_AVX2,
+	ISA_AVX512,
+};
+
+enum KERNEL_PRECISION
+{
+	PRECISION_DOUBLE,
+	// twice the points per instruction, but two neighbouring pixels get the same c once
+	// the frame is less than about 1e-4 across (the region and z are rounded to float)
+	PRECISION_FLOAT,
+};
+
+// work the interior checks saved
+struct InteriorStats
+{
+	unsigned cardioid_points;                // points in the main cardioid or the period-2 bulb
+	unsigned long long cardioid_iterations;  // iterations they didn't run
+	unsigned periodic_points;                // points whose orbit was found to repeat
+	unsigned long long periodic_iterations;  // iterations they didn't run
+};
+
+// c is in the main cardioid or the period-2 bulb (the point never escapes)
+// static, so the copies in the SIMD kernels' files are never picked by the linker for the others
+static inline bool in_cardioid_or_bulb(double cx, double cy)
+{
+	const double x = cx - 0.25;
+	const double y2 = cy * cy;
+	const double q = x * x + y2;
+	return q * (q + x) <= 0.25 * y2 || (cx + 1.0) * (cx + 1.0) + y2 <= 0.0625;
+}
+
+// a batch of points to iterate (the float kernels round c and z to float when they load a point)
+struct EscapeJob
+{
+	const double * cx;      // real part of c for every point
+	const double * cy;      // imaginary part of c for every point
+	unsigned * iterations;  // output - number of iterations before the point escaped (max_iter if it didn't)
+	unsigned count;         // number of points
+	unsigned max_iter;
+	double bailout;         // |z|^2 at which a point escaped (the escape radius squared)
+	// optional (nullptr starts every point at z = 0 after 0 iterations)
+	// input - z and iteration count a point stopped at, output - z it stopped at this time
+	double * zx;
+	double * zy;
+	// optional (nullptr iterates every point until it escapes or reaches max_iter)
+	// runs the interior checks and adds up the work they saved
+	InteriorStats * interior;
+};
+
+typedef void(*EscapeKernelFunction)(const EscapeJob& job);
+
+// best instruction set supported by this CPU and operating system
+KERNEL_ISA detect_isa();
+// SSSE3 byte shuffles are supported (used by the Palette to pack BGR pixels)
+bool detect_ssse3();
+// kernel for the instruction set (falls back to the best supported one below it)
+EscapeKernelFunction escape_kernel(KERNEL_ISA isa, KERNEL_PRECISION precision);
+const char * isa_name(KERNEL_ISA isa);
+const char * precision_name(KERNEL_PRECISION precision);
+// number of points iterated at once
+unsigned isa_lanes(KERNEL_ISA isa, KERNEL_PRECISION precision);
+
+// kernels - defined in EscapeKernel.cpp and EscapeKernel<Isa>.cpp
+void escape_kernel_scalar(const EscapeJob& job);
+void escape_kernel_sse2(const EscapeJob& job);
+void escape_kernel_avx2(const EscapeJob& job);
+void escape_kernel_avx512(const EscapeJob& job);
+void escape_kernel_scalar_float(const EscapeJob& job);
+void escape_kernel_sse2_float(const EscapeJob& job);
+void escape_kernel_avx2_float(const EscapeJob& job);
+void escape_kernel_avx512_float(const EscapeJob& job);
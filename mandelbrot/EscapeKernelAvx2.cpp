@@ -0,0 +1,75 @@
+// AVX2 escape-time kernels - 4 points per instruction (8 in float)
+#include "EscapeKernel.h"
+#ifdef ESCAPE_KERNEL_X86
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define ESCAPE_KERNEL_TARGET
+#else
+#define ESCAPE_KERNEL_TARGET __attribute__((target("avx2")))
+#endif
+#include "EscapeKernelSimd.h"
+
+struct Avx2Float
+{
+	enum { LANES = 8 };
+	typedef float Real;
+	typedef __m256 Float;
+	typedef __m256i Int;
+	typedef __m256 Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const float * p) { return _mm256_load_ps(p); }
+	static ESCAPE_KERNEL_TARGET void store(float * p, Float v) { _mm256_store_ps(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm256_load_si256((const __m256i *)p); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm256_store_si256((__m256i *)p, v); }
+	static ESCAPE_KERNEL_TARGET Float set1(float f) { return _mm256_set1_ps(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm256_set1_epi32(i); }
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm256_add_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm256_sub_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm256_mul_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(b, a)); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm256_blendv_ps(a, b, m); }
+	// a set mask lane is -1, so subtracting it adds one
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm256_sub_epi32(n, _mm256_castps_si256(m)); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return _mm256_movemask_ps(m); }
+};
+
+struct Avx2Double
+{
+	enum { LANES = 4 };
+	typedef double Real;
+	typedef __m256d Float;
+	typedef __m256d Int;
+	typedef __m256d Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const double * p) { return _mm256_load_pd(p); }
+	static ESCAPE_KERNEL_TARGET void store(double * p, Float v) { _mm256_store_pd(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm256_cvtepi32_pd(_mm_load_si128((const __m128i *)p)); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm_store_si128((__m128i *)p, _mm256_cvttpd_epi32(v)); }
+	static ESCAPE_KERNEL_TARGET Float set1(double f) { return _mm256_set1_pd(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm256_set1_pd(i); }
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm256_add_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm256_sub_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm256_mul_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return _mm256_and_pd(a, b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm256_blendv_pd(a, b, m); }
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm256_add_pd(n, _mm256_and_pd(m, _mm256_set1_pd(1.0))); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return _mm256_movemask_pd(m); }
+};
+
+void escape_kernel_avx2(const EscapeJob& job)
+{
+	escape_kernel_simd<Avx2Double>(job);
+}
+
+void escape_kernel_avx2_float(const EscapeJob& job)
+{
+	escape_kernel_simd<Avx2Float>(job);
+}
+#endif
@@ -0,0 +1,78 @@
+// AVX-512 escape-time kernels - 8 points per instruction (16 in float)
+#include "EscapeKernel.h"
+#ifdef ESCAPE_KERNEL_AVX512
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#define ESCAPE_KERNEL_TARGET
+#else
+#define ESCAPE_KERNEL_TARGET __attribute__((target("avx512f")))
+#endif
+#include "EscapeKernelSimd.h"
+
+struct Avx512Float
+{
+	enum { LANES = 16 };
+	typedef float Real;
+	typedef __m512 Float;
+	typedef __m512i Int;
+	typedef __mmask16 Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const float * p) { return _mm512_load_ps(p); }
+	static ESCAPE_KERNEL_TARGET void store(float * p, Float v) { _mm512_store_ps(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm512_load_si512((const void *)p); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm512_store_si512((void *)p, v); }
+	static ESCAPE_KERNEL_TARGET Float set1(float f) { return _mm512_set1_ps(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm512_set1_epi32(i); }
+	// the _round_ forms stop the compiler from fusing mul and add into FMA,
+	// which would give slightly different results than the other kernels
+	// (the zero-masked versions avoid GCC's uninitialized-value warning in _mm512_undefined_ps)
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm512_maskz_add_round_ps(0xFFFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm512_maskz_sub_round_ps(0xFFFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm512_maskz_mul_round_ps(0xFFFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm512_cmplt_epi32_mask(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return (Mask)(a & b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm512_mask_blend_ps(m, a, b); }
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm512_mask_add_epi32(n, m, n, _mm512_set1_epi32(1)); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return (int)m; }
+};
+
+struct Avx512Double
+{
+	enum { LANES = 8 };
+	typedef double Real;
+	typedef __m512d Float;
+	typedef __m512d Int;
+	typedef __mmask8 Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const double * p) { return _mm512_load_pd(p); }
+	static ESCAPE_KERNEL_TARGET void store(double * p, Float v) { _mm512_store_pd(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm512_maskz_cvtepi32_pd(0xFF, _mm256_load_si256((const __m256i *)p)); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm256_store_si256((__m256i *)p, _mm512_maskz_cvttpd_epi32(0xFF, v)); }
+	static ESCAPE_KERNEL_TARGET Float set1(double f) { return _mm512_set1_pd(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm512_set1_pd(i); }
+	// no FMA and zero-masked conversions either, as in the float kernel
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm512_maskz_add_round_pd(0xFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm512_maskz_sub_round_pd(0xFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm512_maskz_mul_round_pd(0xFF, a, b, _MM_FROUND_CUR_DIRECTION); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return (Mask)(a & b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm512_mask_blend_pd(m, a, b); }
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm512_mask_add_pd(n, m, n, _mm512_set1_pd(1.0)); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return (int)m; }
+};
+
+void escape_kernel_avx512(const EscapeJob& job)
+{
+	escape_kernel_simd<Avx512Double>(job);
+}
+
+void escape_kernel_avx512_float(const EscapeJob& job)
+{
+	escape_kernel_simd<Avx512Float>(job);
+}
+#endif
@@ -0,0 +1,207 @@
+// SIMD escape-time kernel shared by EscapeKernelSse2.cpp, EscapeKernelAvx2.cpp and EscapeKernelAvx512.cpp.
+// Every one of those files defines ESCAPE_KERNEL_TARGET (the GCC/Clang target attribute of its instruction set)
+// and two traits structs wrapping the intrinsics (double and float lanes), then instantiates escape_kernel_simd with them.
+// The double traits keep the iteration counts in double lanes too, so a mask lane lines up with a count lane.
+// No standard library headers are included here - inline functions compiled for AVX2/AVX-512
+// could otherwise be picked by the linker for code running on hosts without them.
+#pragma once
+#include "EscapeKernel.h"
+
+#if defined(_MSC_VER)
+#define ESCAPE_KERNEL_ALIGN(n) __declspec(align(n))
+#else
+#define ESCAPE_KERNEL_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
+// c of a point and the z and iteration count it starts from
+template <class Real>
+static inline void load_point(const EscapeJob& job, unsigned i, Real& cx, Real& cy, Real& zx, Real& zy, int& n)
+{
+	cx = Real(job.cx[i]);
+	cy = Real(job.cy[i]);
+	if (job.zx)
+	{
+		zx = Real(job.zx[i]);
+		zy = Real(job.zy[i]);
+		n = (int)job.iterations[i];
+	}
+	else
+	{
+		zx = 0;
+		zy = 0;
+		n = 0;
+	}
+}
+
+// with the interior checks on, a point in the main cardioid or the period-2 bulb is finished without iterating it
+static inline bool reject_point(const EscapeJob& job, unsigned i)
+{
+	const unsigned iterations = job.zx ? job.iterations[i] : 0;
+	if (!job.interior || iterations >= job.max_iter || !in_cardioid_or_bulb(job.cx[i], job.cy[i])) { return false; }
+	++job.interior->cardioid_points;
+	job.interior->cardioid_iterations += job.max_iter - iterations;
+	// z stays where it was
+	job.iterations[i] = job.max_iter;
+	return true;
+}
+
+template <class T>
+ESCAPE_KERNEL_TARGET void escape_kernel_simd(const EscapeJob& job)
+{
+	typedef typename T::Real Real;
+	typedef typename T::Float Float;
+	typedef typename T::Int Int;
+	typedef typename T::Mask Mask;
+	const unsigned lanes = T::LANES;
+	const int all_live = (1 << lanes) - 1;
+
+	// lane state is spilled to these arrays only when a lane has to be refilled
+	ESCAPE_KERNEL_ALIGN(64) Real cx[T::LANES];
+	ESCAPE_KERNEL_ALIGN(64) Real cy[T::LANES];
+	ESCAPE_KERNEL_ALIGN(64) Real zx[T::LANES];
+	ESCAPE_KERNEL_ALIGN(64) Real zy[T::LANES];
+	ESCAPE_KERNEL_ALIGN(64) int n[T::LANES];
+	// z of every lane at the last checkpoint of the cycle detection
+	ESCAPE_KERNEL_ALIGN(64) Real saved_x[T::LANES];
+	ESCAPE_KERNEL_ALIGN(64) Real saved_y[T::LANES];
+	// point each lane is working on (-1 for an idle lane)
+	int point[T::LANES];
+
+	const int max_iter = (int)job.max_iter;
+	// a lane refilled after the last checkpoint can't match until the next one
+	const Real no_checkpoint = Real(1.0e30f);
+	unsigned next = 0;
+	unsigned active = 0;
+	for (unsigned lane = 0; lane < lanes; ++lane)
+	{
+		while (next < job.count && reject_point(job, next)) { ++next; }
+		saved_x[lane] = no_checkpoint;
+		saved_y[lane] = no_checkpoint;
+		if (next < job.count)
+		{
+			point[lane] = next;
+			load_point(job, next, cx[lane], cy[lane], zx[lane], zy[lane], n[lane]);
+			++next;
+			++active;
+		}
+		else
+		{
+			// idle lanes start at max_iter so they are never live
+			point[lane] = -1;
+			cx[lane] = 0;
+			cy[lane] = 0;
+			zx[lane] = 0;
+			zy[lane] = 0;
+			n[lane] = max_iter;
+		}
+	}
+
+	Float vcx = T::load(cx);
+	Float vcy = T::load(cy);
+	Float vzx = T::load(zx);
+	Float vzy = T::load(zy);
+	Int vn = T::loadi(n);
+	const Int vmax = T::set1i(max_iter);
+	const Float bailout = T::set1(Real(job.bailout));
+	// cycle detection - z is compared with the checkpoint after every block of ESCAPE_CHECK_INTERVAL iterations,
+	// the checkpoints are taken for all the lanes at once, 1, 2, 4, ... blocks apart
+	Float vsaved_x = T::load(saved_x);
+	Float vsaved_y = T::load(saved_y);
+	const Real epsilon = sizeof(Real) == sizeof(float) ? Real(PERIODICITY_EPSILON) : Real(PERIODICITY_EPSILON_DOUBLE);
+	const Float epsilon2 = T::set1(epsilon * epsilon);
+	unsigned block = 0;
+	unsigned interval = 1;
+	unsigned checkpoint = 1;
+
+	while (active > 0)
+	{
+		// run ESCAPE_CHECK_INTERVAL iterations without looking at the lanes -
+		// an escaped lane keeps its z and iteration count, so the result is exact
+		Mask live;
+		for (unsigned k = 0; k < ESCAPE_CHECK_INTERVAL; ++k)
+		{
+			const Float x2 = T::mul(vzx, vzx);
+			const Float y2 = T::mul(vzy, vzy);
+			const Float xy = T::mul(vzx, vzy);
+			// |z|^2 < radius^2 is the same test as |z| < radius without the sqrt
+			live = T::and_mask(T::less(T::add(x2, y2), bailout), T::lessi(vn, vmax));
+			vzx = T::select(live, vzx, T::add(T::sub(x2, y2), vcx));
+			vzy = T::select(live, vzy, T::add(T::add(xy, xy), vcy));
+			vn = T::increment(vn, live);
+		}
+		int live_bits = T::movemask(live);
+		// lanes whose orbit came back to the checkpoint are finished too
+		int periodic_bits = 0;
+		if (job.interior)
+		{
+			++block;
+			if (block == checkpoint)
+			{
+				vsaved_x = vzx;
+				vsaved_y = vzy;
+				if (interval * ESCAPE_CHECK_INTERVAL < PERIODICITY_MAX_INTERVAL) { interval *= 2; }
+				checkpoint = block + interval;
+			}
+			else
+			{
+				const Float dx = T::sub(vzx, vsaved_x);
+				const Float dy = T::sub(vzy, vsaved_y);
+				periodic_bits = T::movemask(T::and_mask(live, T::less(T::add(T::mul(dx, dx), T::mul(dy, dy)), epsilon2)));
+				live_bits &= ~periodic_bits;
+			}
+		}
+		if (live_bits == all_live) { continue; }
+
+		// write out escaped (or finished) lanes and load the next pending points into them
+		T::store(cx, vcx);
+		T::store(cy, vcy);
+		T::store(zx, vzx);
+		T::store(zy, vzy);
+		T::storei(n, vn);
+		T::store(saved_x, vsaved_x);
+		T::store(saved_y, vsaved_y);
+		for (unsigned lane = 0; lane < lanes; ++lane)
+		{
+			if (live_bits & (1 << lane)) { continue; }
+			if (periodic_bits & (1 << lane))
+			{
+				// the orbit repeats - the point never escapes
+				++job.interior->periodic_points;
+				job.interior->periodic_iterations += max_iter - n[lane];
+				n[lane] = max_iter;
+			}
+			if (point[lane] >= 0)
+			{
+				job.iterations[point[lane]] = (unsigned)n[lane];
+				if (job.zx)
+				{
+					job.zx[point[lane]] = zx[lane];
+					job.zy[point[lane]] = zy[lane];
+				}
+				--active;
+			}
+			while (next < job.count && reject_point(job, next)) { ++next; }
+			saved_x[lane] = no_checkpoint;
+			saved_y[lane] = no_checkpoint;
+			if (next < job.count)
+			{
+				point[lane] = next;
+				load_point(job, next, cx[lane], cy[lane], zx[lane], zy[lane], n[lane]);
+				++next;
+				++active;
+			}
+			else
+			{
+				point[lane] = -1;
+				n[lane] = max_iter;
+			}
+		}
+		vcx = T::load(cx);
+		vcy = T::load(cy);
+		vzx = T::load(zx);
+		vzy = T::load(zy);
+		vn = T::loadi(n);
+		vsaved_x = T::load(saved_x);
+		vsaved_y = T::load(saved_y);
+	}
+}
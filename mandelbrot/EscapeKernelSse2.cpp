@@ -0,0 +1,75 @@
+// SSE2 escape-time kernels - 2 points per instruction (4 in float)
+#include "EscapeKernel.h"
+#ifdef ESCAPE_KERNEL_X86
+#include <emmintrin.h>
+
+#if defined(_MSC_VER)
+#define ESCAPE_KERNEL_TARGET
+#else
+#define ESCAPE_KERNEL_TARGET __attribute__((target("sse2")))
+#endif
+#include "EscapeKernelSimd.h"
+
+struct Sse2Float
+{
+	enum { LANES = 4 };
+	typedef float Real;
+	typedef __m128 Float;
+	typedef __m128i Int;
+	typedef __m128 Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const float * p) { return _mm_load_ps(p); }
+	static ESCAPE_KERNEL_TARGET void store(float * p, Float v) { _mm_store_ps(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm_load_si128((const __m128i *)p); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm_store_si128((__m128i *)p, v); }
+	static ESCAPE_KERNEL_TARGET Float set1(float f) { return _mm_set1_ps(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm_set1_epi32(i); }
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm_sub_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm_castsi128_ps(_mm_cmplt_epi32(a, b)); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return _mm_and_ps(a, b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm_or_ps(_mm_and_ps(m, b), _mm_andnot_ps(m, a)); }
+	// a set mask lane is -1, so subtracting it adds one
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm_sub_epi32(n, _mm_castps_si128(m)); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return _mm_movemask_ps(m); }
+};
+
+struct Sse2Double
+{
+	enum { LANES = 2 };
+	typedef double Real;
+	typedef __m128d Float;
+	typedef __m128d Int;
+	typedef __m128d Mask;
+
+	static ESCAPE_KERNEL_TARGET Float load(const double * p) { return _mm_load_pd(p); }
+	static ESCAPE_KERNEL_TARGET void store(double * p, Float v) { _mm_store_pd(p, v); }
+	static ESCAPE_KERNEL_TARGET Int loadi(const int * p) { return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i *)p)); }
+	static ESCAPE_KERNEL_TARGET void storei(int * p, Int v) { _mm_storel_epi64((__m128i *)p, _mm_cvttpd_epi32(v)); }
+	static ESCAPE_KERNEL_TARGET Float set1(double f) { return _mm_set1_pd(f); }
+	static ESCAPE_KERNEL_TARGET Int set1i(int i) { return _mm_set1_pd(i); }
+	static ESCAPE_KERNEL_TARGET Float add(Float a, Float b) { return _mm_add_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Float sub(Float a, Float b) { return _mm_sub_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Float mul(Float a, Float b) { return _mm_mul_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask less(Float a, Float b) { return _mm_cmplt_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask lessi(Int a, Int b) { return _mm_cmplt_pd(a, b); }
+	static ESCAPE_KERNEL_TARGET Mask and_mask(Mask a, Mask b) { return _mm_and_pd(a, b); }
+	// b where the mask is set, a elsewhere
+	static ESCAPE_KERNEL_TARGET Float select(Mask m, Float a, Float b) { return _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a)); }
+	static ESCAPE_KERNEL_TARGET Int increment(Int n, Mask m) { return _mm_add_pd(n, _mm_and_pd(m, _mm_set1_pd(1.0))); }
+	static ESCAPE_KERNEL_TARGET int movemask(Mask m) { return _mm_movemask_pd(m); }
+};
+
+void escape_kernel_sse2(const EscapeJob& job)
+{
+	escape_kernel_simd<Sse2Double>(job);
+}
+
+void escape_kernel_sse2_float(const EscapeJob& job)
+{
+	escape_kernel_simd<Sse2Float>(job);
+}
+#endif
@@ -0,0 +1,67 @@
+// Frame definitions shared by the Mandelbrot class and the compute backends
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "CancelToken.h"
+
+#define TILE_SIZE 8
+
+enum CALC_MANDELBROT
+{
+	AMP_MANDELBROT,
+	AMP_PIXEL_MANDELBROT,
+	AMP_BARRIER_MANDELBROT,
+	CPU_MANDELBROT,
+};
+
+// name of the calculation method (used in timing file names)
+const char * method_name(CALC_MANDELBROT method);
+// does the method store escape counts (coloured afterwards by the Palette) instead of colours
+bool stores_iterations(CALC_MANDELBROT method);
+
+// what to calculate
+struct FrameRequest
+{
+	CALC_MANDELBROT method;
+	// The size of the image to generate (any size, not only multiples of TILE_SIZE).
+	unsigned width, height;
+	// region on the complex plane to plot (the C++ AMP kernels round it to float, the CPU engine iterates in double)
+	double left, right, top, bottom;
+	// The number of times to iterate before we assume that a point isn't in the Mandelbrot set.
+	unsigned max_iter;
+	// a point escaped once |z| reached the escape radius
+	float escape_radius;
+	// blue, green and red colours
+	unsigned r, g, b;
+	// backends may reuse work kept from previous frames (off for timing runs so every frame is calculated)
+	bool reuse_previous;
+	// pixel the user looks at (the centre of the frame or the one under the cursor) - backends calculating in tiles
+	// start with the tiles nearest to it when focus_first is set
+	unsigned focus_x, focus_y;
+	bool focus_first;
+	// set once a newer request was submitted - backends stop between tiles
+	CancelToken cancel;
+};
+
+// told about the parts of a progressive frame finished so far
+class FrameProgress
+{
+public:
+	virtual ~FrameProgress() {}
+	// called on the compute thread between two parts - done of total tiles (or pixels) are calculated,
+	// the rest of the target holds a placeholder (e.g. the last frame reprojected or the pixels around it)
+	virtual void frame_progress(unsigned done, unsigned total) = 0;
+};
+
+// buffers the calculation methods write into (owned by the FrameRenderer, width * height elements)
+struct FrameTarget
+{
+	// amp_mandelbrot and cpu_mandelbrot - escape count of every pixel (iterations[x * height + y])
+	uint32_t * iterations;
+	// amp_pixel_mandelbrot and amp_barrier_mandelbrot - packed BGRA texel of every pixel
+	// in the row order glTexImage2D expects (texels[y * width + x] = 0xAARRGGBB)
+	uint32_t * texels;
+	// backends able to calculate a frame in parts report them here, the centre or a coarse grid first
+	// (nullptr - the whole frame at once)
+	FrameProgress * progress;
+};
@@ -0,0 +1,89 @@
+#include "FrameBuffers.h"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#endif
+
+// number of texels holding bytes bytes
+static std::size_t texels(std::size_t bytes)
+{
+	return (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+}
+
+// resize a buffer, giving its memory back when it is more than twice as large as needed
+// (e.g. after a 16k timing run the window sized frames don't keep 1 GB)
+static void fit(std::vector<uint32_t>& buffer, std::size_t count)
+{
+	if (buffer.capacity() > 2 * count)
+	{
+		std::vector<uint32_t>().swap(buffer);
+	}
+	buffer.resize(count);
+}
+
+FrameBuffers::FrameBuffers()
+{
+#ifdef _WIN32
+	low_memory_ = CreateMemoryResourceNotification(LowMemoryResourceNotification);
+#else
+	meminfo_ = open("/proc/meminfo", O_RDONLY);
+#endif
+}
+
+FrameBuffers::~FrameBuffers()
+{
+#ifdef _WIN32
+	if (low_memory_) { CloseHandle(low_memory_); }
+#else
+	if (meminfo_ >= 0) { close(meminfo_); }
+#endif
+}
+
+uint32_t * FrameBuffers::iterations(unsigned width, unsigned height)
+{
+	fit(iterations_, std::size_t(width) * height);
+	return iterations_.data();
+}
+
+void FrameBuffers::release_iterations()
+{
+	std::vector<uint32_t>().swap(iterations_);
+}
+
+uint8_t * FrameBuffers::pixels(std::vector<uint32_t>& buffer, std::size_t bytes)
+{
+	// whole texels, so BGRA frames can be written as uint32_t
+	fit(buffer, texels(bytes));
+	return reinterpret_cast<uint8_t *>(buffer.data());
+}
+
+bool FrameBuffers::fits(const std::vector<uint32_t>& buffer, std::size_t bytes)
+{
+	const std::size_t count = texels(bytes);
+	return buffer.capacity() >= count && buffer.capacity() <= 2 * count;
+}
+
+bool FrameBuffers::memory_low()
+{
+#ifdef _WIN32
+	BOOL low = FALSE;
+	return low_memory_ && QueryMemoryResourceNotification(low_memory_, &low) && low;
+#else
+	// less than a tenth of the physical memory available
+	// (MemTotal and MemAvailable are among the first lines, a buffer on the stack holds them)
+	char text[512];
+	const ssize_t size = meminfo_ >= 0 ? pread(meminfo_, text, sizeof(text) - 1, 0) : -1;
+	if (size <= 0) { return false; }
+	text[size] = '\0';
+	const char * total = std::strstr(text, "MemTotal:");
+	const char * available = std::strstr(text, "MemAvailable:");
+	if (total == nullptr || available == nullptr) { return false; }
+	const unsigned long long total_kb = std::strtoull(total + std::strlen("MemTotal:"), nullptr, 10);
+	const unsigned long long available_kb = std::strtoull(available + std::strlen("MemAvailable:"), nullptr, 10);
+	return total_kb > 0 && available_kb > 0 && available_kb < total_kb / 10;
+#endif
+}
@@ -0,0 +1,36 @@
+// FrameBuffers class
+// Memory the compute thread calculates frames into. Nothing is allocated up front: a buffer is sized
+// the first time a frame needs it and shared by all the calculation methods instead of one set per method -
+// one buffer of escape counts (amp_mandelbrot and cpu_mandelbrot, kept for recolouring) and the pixel buffer
+// of every DisplayFrame, which holds BGR bytes or BGRA texels depending on the method.
+// Buffers much larger than the current frame are shrunk, and when the operating system reports
+// that physical memory is low the renderer gives back everything the frame on screen doesn't need.
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class FrameBuffers
+{
+public:
+	FrameBuffers();
+	~FrameBuffers();
+	// shared escape counts of a width x height frame
+	uint32_t * iterations(unsigned width, unsigned height);
+	// give the escape counts back (they are lost)
+	void release_iterations();
+	std::size_t iteration_bytes() const { return iterations_.capacity() * sizeof(uint32_t); }
+	// size the pixel buffer of a display frame to hold bytes bytes
+	static uint8_t * pixels(std::vector<uint32_t>& buffer, std::size_t bytes);
+	// pixels() can use the buffer as it is, without allocating
+	static bool fits(const std::vector<uint32_t>& buffer, std::size_t bytes);
+	// the operating system reports that physical memory is running low (polled with every job, doesn't allocate)
+	bool memory_low();
+private:
+	std::vector<uint32_t> iterations_;
+#ifdef _WIN32
+	void * low_memory_; // low memory resource notification (HANDLE)
+#else
+	int meminfo_; // /proc/meminfo, opened once and read again from the start on every poll
+#endif
+};
@@ -0,0 +1,330 @@
+#include "FrameRenderer.h"
+#include "dependencies.h"
+#include "AllocationCounter.h"
+#include <cassert>
+
+FrameRenderer::FrameRenderer() :
+	stop_(false),
+	has_job_(false),
+	calculating_(false),
+	busy_(false),
+	latest_request_(0),
+	upload_ms_(0.0),
+	frames_cancelled_(0),
+	cancelled_ms_(0.0),
+	generation_(0),
+	has_iterations_(false),
+	iterations_request_(),
+	last_backend_(nullptr),
+	memory_low_(false),
+	progress_request_(nullptr),
+	progress_iterations_(nullptr),
+	progress_sized_(false),
+	steady_shape_(),
+	steady_frames_(0)
+{
+	// start the thread once everything it uses is constructed
+	thread_ = std::thread(&FrameRenderer::run, this);
+}
+
+FrameRenderer::~FrameRenderer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_one();
+	thread_.join();
+	for (auto& file : timing_files_)
+	{
+		file.second.close();
+	}
+}
+
+void FrameRenderer::submit(const RenderJob& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (has_job_)
+		{
+			// the job replaced still has to calculate its frame (a recolour doesn't) and run its timings
+			RenderJob merged = job;
+			merged.recolour = job_.recolour && job.recolour;
+			merged.timings = job_.timings > job.timings ? job_.timings : job.timings;
+			merged.progressive = job_.progressive || job.progressive;
+			job_ = merged;
+		}
+		else
+		{
+			job_ = job;
+		}
+		// a recolour waits for the calculation being run instead of cancelling it (and is applied to its counts)
+		const unsigned long generation = job_.recolour && calculating_ ? latest_request_.load() : latest_request_ + 1;
+		job_.request.cancel = CancelToken(&latest_request_, generation);
+		latest_request_ = generation;
+		has_job_ = true;
+	}
+	wake_.notify_one();
+}
+
+void FrameRenderer::post(const std::function<void()>& command)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		commands_.push_back(command);
+	}
+	wake_.notify_one();
+}
+
+const DisplayFrame * FrameRenderer::acquire()
+{
+	frames_.acquire();
+	const DisplayFrame& frame = frames_.front();
+	return frame.generation > 0 ? &frame : nullptr;
+}
+
+void FrameRenderer::run()
+{
+	for (;;)
+	{
+		RenderJob job;
+		bool has_job;
+		std::vector<std::function<void()>> commands;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [this]() { return stop_ || has_job_ || !commands_.empty(); });
+			if (stop_) { return; }
+			commands.swap(commands_);
+			job = job_;
+			has_job = has_job_;
+			has_job_ = false;
+			calculating_ = has_job && !job.recolour;
+			busy_ = has_job;
+		}
+		for (auto& command : commands)
+		{
+			command();
+		}
+		if (has_job) { render(job); }
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			calculating_ = false;
+		}
+		busy_ = false;
+	}
+}
+
+std::ofstream& FrameRenderer::timing_file(const FrameRequest& request, Backend * backend)
+{
+	const CALC_MANDELBROT method = request.method;
+	const std::string size = std::to_string(request.width) + "x" + std::to_string(request.height);
+	const std::string file_name = std::string(method_name(method)) + "_" + backend->name() + "_" + size + "_.csv";
+	auto file = timing_files_.find(file_name);
+	if (file == timing_files_.end())
+	{
+		file = timing_files_.emplace(file_name, std::ofstream(file_name)).first;
+		file->second << method_name(method) << " using " << backend->description() << endl;
+		file->second << "TILE_SIZE " << TILE_SIZE << ", frame " << size << endl;
+		file->second << backend->csv_header();
+		// the palette pass is timed on its own to show its share of the frame
+		if (stores_iterations(method)) { file->second << ",palette_milliseconds"; }
+		file->second << endl;
+	}
+	return file->second;
+}
+
+bool FrameRenderer::can_recolour(const FrameRequest& request) const
+{
+	const FrameRequest& counts = iterations_request_;
+	return has_iterations_ && stores_iterations(request.method) && counts.method == request.method &&
+		counts.width == request.width && counts.height == request.height && counts.max_iter == request.max_iter &&
+		counts.escape_radius == request.escape_radius && counts.left == request.left && counts.right == request.right &&
+		counts.top == request.top && counts.bottom == request.bottom;
+}
+
+// Everything but the frames handed to the display thread is allocated again when it's needed.
+void FrameRenderer::release_memory()
+{
+	const std::size_t bytes = buffers_.iteration_bytes();
+	buffers_.release_iterations();
+	has_iterations_ = false;
+	BackendRegistry& backends = BackendRegistry::instance();
+	for (unsigned i = 0; i < backends.size(); ++i)
+	{
+		backends[i].release_buffers();
+	}
+	steady_frames_ = 0;
+	cout << "Memory is low - released the escape counts (" << bytes / (1024 * 1024) << " MB) and the state kept by the backends" << endl;
+}
+
+DisplayFrame& FrameRenderer::back_frame(const FrameRequest& request)
+{
+	DisplayFrame& frame = frames_.back();
+	frame.method = request.method;
+	frame.width = request.width;
+	frame.height = request.height;
+	frame.left = request.left;
+	frame.right = request.right;
+	frame.top = request.top;
+	frame.bottom = request.bottom;
+	return frame;
+}
+
+void FrameRenderer::frame_progress(unsigned /*done*/, unsigned /*total*/)
+{
+	const FrameRequest& request = *progress_request_;
+	DisplayFrame& frame = back_frame(request);
+	const std::size_t bytes = std::size_t(request.width) * request.height * 3;
+	if (!FrameBuffers::fits(frame.pixels, bytes)) { progress_sized_ = true; }
+	uint8_t * pixels = FrameBuffers::pixels(frame.pixels, bytes);
+	palette_.apply(progress_iterations_, request.width, request.height, pixels);
+	frame.generation = ++generation_;
+	frames_.publish();
+}
+
+// Calculate the frame(s) of the job into the back buffer and publish them.
+void FrameRenderer::render(const RenderJob& job)
+{
+	FrameRequest request = job.request;
+	Backend * backend = job.backend;
+	// timing runs calculate every frame from scratch
+	if (job.timings > 0) { request.reuse_previous = false; }
+	if (backend == nullptr || !backend->supports(request.method))
+	{
+		cout << "No backend found for " << method_name(request.method) << endl;
+		return;
+	}
+	// opened (or created) once per job, not for every frame
+	std::ofstream * file = job.timings > 0 ? &timing_file(request, backend) : nullptr;
+	// allocations of the job so far - everything after the timing file is looked up must reuse the buffers
+	// of earlier frames once they are warmed up
+	unsigned long allocations = thread_allocations();
+	// react once when the operating system starts reporting low memory
+	const bool memory_low = buffers_.memory_low();
+	if (memory_low && !memory_low_) { release_memory(); }
+	memory_low_ = memory_low;
+	// only the buffers of the backend in use are kept
+	if (last_backend_ != nullptr && last_backend_ != backend) { last_backend_->release_buffers(); }
+	last_backend_ = backend;
+	// amp_pixel_mandelbrot and amp_barrier_mandelbrot calculate the colours in their kernels
+	// a recolour of counts calculated for another region (or max_iter) calculates the frame instead
+	const bool recolour = job.recolour && can_recolour(request);
+	const unsigned frames = job.timings > 0 ? job.timings : 1;
+	// the shape of the frames of this job
+	const FrameShape shape = { request.method, backend, request.width, request.height, request.max_iter };
+	const bool allocation_free = backend->capabilities().allocation_free;
+
+	for (unsigned i = 0; i < frames; ++i)
+	{
+		// a newer request is waiting - stop the timing run
+		if (request.cancel.cancelled()) { return; }
+		if (!(shape == steady_shape_))
+		{
+			steady_shape_ = shape;
+			steady_frames_ = 0;
+		}
+		DisplayFrame * frame = &back_frame(request);
+		// one pixel buffer for every method - 3 bytes per pixel for BGR, 4 for BGRA texels
+		const std::size_t bytes = std::size_t(request.width) * request.height * (stores_iterations(request.method) ? 3 : 4);
+		// everything from here until the frame is coloured must reuse the buffers of earlier frames
+		// (each buffer of the TripleBuffer is sized the first time it's used for this shape)
+		const bool warm = steady_frames_ > 0 && FrameBuffers::fits(frame->pixels, bytes);
+		progress_sized_ = false;
+		uint8_t * pixels = FrameBuffers::pixels(frame->pixels, bytes);
+
+		if (recolour)
+		{
+			// colour the stored escape counts with the new colours without calculating the Mandelbrot set again
+			palette_.build(iterations_request_.max_iter, request.r, request.g, request.b, job.palette_offset);
+			palette_.apply(buffers_.iterations(request.width, request.height), request.width, request.height, pixels);
+			assert(!warm || thread_allocations() == allocations);
+			cout << "Recolouring took " << palette_.milliseconds() << " ms." << endl;
+		}
+		else
+		{
+			// the escape counts are only allocated for the methods storing them
+			// amp_pixel_mandelbrot and amp_barrier_mandelbrot write their texels straight into the displayed frame
+			FrameTarget target = { nullptr, frame->pixels.data(), nullptr };
+			if (stores_iterations(request.method)) { target.iterations = buffers_.iterations(request.width, request.height); }
+			// the parts of a progressive frame are coloured and shown while the rest is calculated
+			const bool progressive = (job.progressive || backend->capabilities().progressive) && job.timings == 0 &&
+				stores_iterations(request.method);
+			if (progressive)
+			{
+				palette_.build(request.max_iter, request.r, request.g, request.b, job.palette_offset);
+				progress_request_ = &request;
+				progress_iterations_ = target.iterations;
+				target.progress = this;
+			}
+
+			if (backend->capabilities().emulated)
+				cout << "Calculating Mandelbrot..." << endl;
+			// Start timing
+			the_clock::time_point start = the_clock::now();
+			if (!backend->render(request, target))
+			{
+				// superseded by a newer request - drop the frame and start the newest one
+				if (stores_iterations(request.method)) { has_iterations_ = false; }
+				const double wasted = std::chrono::duration<double, std::milli>(the_clock::now() - start).count();
+				++frames_cancelled_;
+				cancelled_ms_ += wasted;
+				cout << "Frame " << request.cancel.generation() << " cancelled after " << wasted << " ms ("
+					<< frames_cancelled_ << " cancelled frames, " << cancelled_ms_ << " ms in total)" << endl;
+				return;
+			}
+			if (stores_iterations(request.method))
+			{
+				// remember which maximum the counts were calculated with and colour them
+				has_iterations_ = true;
+				iterations_request_ = request;
+				// the parts published on the way took the back buffer the frame was started in
+				if (progressive)
+				{
+					frame = &back_frame(request);
+					if (!FrameBuffers::fits(frame->pixels, bytes)) { progress_sized_ = true; }
+					pixels = FrameBuffers::pixels(frame->pixels, bytes);
+				}
+				palette_.build(iterations_request_.max_iter, request.r, request.g, request.b, job.palette_offset);
+				palette_.apply(target.iterations, request.width, request.height, pixels);
+			}
+			else if (has_iterations_ || buffers_.iteration_bytes() > 0)
+			{
+				// the escape counts of an earlier frame aren't shown any more
+				buffers_.release_iterations();
+				has_iterations_ = false;
+			}
+			the_clock::time_point end = the_clock::now();
+			// a warmed up frame didn't allocate - nor did the job before it (the poll for low memory, the frames before)
+			// unless a part of a progressive frame sized one of the other frame buffers for the first time
+			assert(!allocation_free || !warm || progress_sized_ || thread_allocations() == allocations);
+			// Compute the difference between the two times in milliseconds
+			auto time_taken = duration_cast<milliseconds>(end - start).count();
+
+			// put timings into the file of the Mandelbot set calculation method and backend
+			if (job.timings > 0)
+			{
+				backend->csv_row(*file, (double)time_taken);
+				if (stores_iterations(request.method)) { *file << "," << palette_.milliseconds(); }
+				*file << endl;
+				std::cout << i << "\n";
+			} // display single timings
+			else
+			{
+				cout << "Computing Mandelbrot using " << backend->description() << " took " << time_taken << " ms." << endl;
+				backend->print_frame_stats(cout);
+				if (stores_iterations(request.method))
+				{
+					cout << "  palette pass: " << palette_.milliseconds() << " ms ("
+						<< (time_taken > 0 ? 100.0 * palette_.milliseconds() / time_taken : 0.0) << "% of the frame)" << endl;
+				}
+				cout << "  texture upload of the last frame shown: " << upload_ms_ << " ms" << endl;
+			}
+		}
+		// hand the frame over to the display thread
+		++steady_frames_;
+		frame->generation = ++generation_;
+		frames_.publish();
+		// the frames after one that sized its buffers must not allocate either
+		if (!warm || progress_sized_) { allocations = thread_allocations(); }
+	}
+}
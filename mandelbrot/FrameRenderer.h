@@ -0,0 +1,127 @@
+// FrameRenderer class
+// Calculates the Mandelbrot set on a dedicated compute thread, so the GLUT display thread
+// keeps drawing (and reading input) however long a frame takes.
+// Finished frames are handed over through a TripleBuffer; Mandelbrot::render() draws the newest one.
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <vector>
+#include "Frame.h"
+#include "Backend.h"
+#include "Palette.h"
+#include "FrameBuffers.h"
+#include "TripleBuffer.h"
+
+// a frame ready to be displayed
+struct DisplayFrame
+{
+	CALC_MANDELBROT method;
+	unsigned long generation;       // number of the frame (0 - nothing calculated yet)
+	unsigned width, height;         // size of the image
+	double left, right, top, bottom; // region of the complex plane it shows (to reproject it onto a newer view)
+	// BGR bytes (amp_mandelbrot and cpu_mandelbrot) or packed BGRA texels (amp_pixel_mandelbrot and amp_barrier_mandelbrot)
+	std::vector<uint32_t> pixels;
+};
+
+// what decides the buffers a frame needs - frames of the same shape reuse them
+struct FrameShape
+{
+	CALC_MANDELBROT method;
+	Backend * backend;
+	unsigned width, height;
+	unsigned max_iter;
+	bool operator==(const FrameShape& other) const
+	{
+		return method == other.method && backend == other.backend && width == other.width &&
+			height == other.height && max_iter == other.max_iter;
+	}
+};
+
+// what the compute thread is asked to do
+struct RenderJob
+{
+	FrameRequest request;
+	Backend * backend;
+	bool recolour;           // only the colours changed - colour the stored escape counts again
+	unsigned palette_offset; // palette cycling
+	unsigned timings;        // number of frames to calculate and write into the timing file (0 - one frame, print its time)
+	bool progressive;        // publish the parts of the frame calculated so far, the centre first (zooming)
+	                         // (backends calculating every frame in parts publish them anyway)
+};
+
+class FrameRenderer : private FrameProgress
+{
+public:
+	FrameRenderer();
+	~FrameRenderer();
+	// queue a job - latest wins: replaces a job that hasn't been started yet (keeping the calculation, timings
+	// and progressive parts it asked for) and cancels the one being calculated, which stops at its next tile.
+	// A job that only recolours doesn't cancel a calculation - it runs once the calculation is finished.
+	void submit(const RenderJob& job);
+	// run a command on the compute thread between two frames (e.g. changing the settings of a backend)
+	void post(const std::function<void()>& command);
+	// the compute thread is calculating a frame
+	bool busy() const { return busy_; }
+	// newest finished frame (nullptr until the first frame is finished)
+	const DisplayFrame * acquire();
+	// the display thread uploaded a frame into its texture (printed with the stats of the next frame)
+	void frame_uploaded(double milliseconds) { upload_ms_ = milliseconds; }
+private:
+	void run();
+	void render(const RenderJob& job);
+	// back buffer set up for a frame of the request
+	DisplayFrame& back_frame(const FrameRequest& request);
+	// colour the escape counts of a progressive frame calculated so far and publish them
+	void frame_progress(unsigned done, unsigned total) override;
+	// give back the memory the frame on screen doesn't need
+	void release_memory();
+	// timing file of the method and backend, created when it's first used
+	std::ofstream& timing_file(const FrameRequest& request, Backend * backend);
+	// the stored escape counts were calculated for the region, size and max_iter of the request
+	bool can_recolour(const FrameRequest& request) const;
+
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	bool stop_;
+	RenderJob job_;
+	bool has_job_;
+	bool calculating_; // the job being run calculates the Mandelbrot set (doesn't only recolour)
+	std::vector<std::function<void()>> commands_;
+	std::atomic<bool> busy_;
+	// generation of the newest submitted request (cancels older ones)
+	std::atomic<unsigned long> latest_request_;
+	// time the last frame shown took to upload
+	std::atomic<double> upload_ms_;
+	// frames given up because a newer request came in and the time spent on them
+	unsigned frames_cancelled_;
+	double cancelled_ms_;
+
+	// frames handed to the display thread
+	TripleBuffer<DisplayFrame> frames_;
+	unsigned long generation_;
+	// escape counts (amp_mandelbrot and cpu_mandelbrot) coloured by the Palette
+	FrameBuffers buffers_;
+	Palette palette_;
+	bool has_iterations_;           // the escape counts of a calculated frame are kept for recolouring
+	FrameRequest iterations_request_; // request they were calculated for
+	// backend of the last frame - the buffers of the previous one are released when it changes
+	Backend * last_backend_;
+	bool memory_low_;
+	// request and escape counts of the progressive frame being calculated
+	const FrameRequest * progress_request_;
+	const uint32_t * progress_iterations_;
+	// a part of the frame was drawn into a back buffer sized for the first time (the frame may allocate)
+	bool progress_sized_;
+	// number of frames in a row with the same shape - after the first one, frames of allocation free backends
+	// drawn into an already sized frame buffer must not allocate any more (asserted in debug builds)
+	FrameShape steady_shape_;
+	unsigned steady_frames_;
+	// files to store timings - one per calculation method, backend and frame size ("<method>_<backend>_<width>x<height>_.csv")
+	std::map<std::string, std::ofstream> timing_files_;
+};
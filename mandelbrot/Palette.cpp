@@ -0,0 +1,111 @@
+#include "Palette.h"
+#include "EscapeKernel.h"
+#include <chrono>
+#ifdef ESCAPE_KERNEL_X86
+#include <tmmintrin.h>
+#endif
+
+// pixels are transposed in PALETTE_BLOCK x PALETTE_BLOCK blocks (16 KB of colours, stays in the L1 cache)
+// and one task converts a band of PALETTE_BLOCK rows
+// 64 reads 256 contiguous bytes of every column - smaller blocks were twice as slow at 2048x2048
+#define PALETTE_BLOCK 64
+
+// write n 0x00RRGGBB colours as BGR bytes
+static void pack_bgr_scalar(const uint32_t * colours, unsigned n, uint8_t * out)
+{
+	for (unsigned i = 0; i < n; ++i)
+	{
+		out[0] = colours[i] & 0xFF;         // blue channel
+		out[1] = (colours[i] >> 8) & 0xFF;  // green channel
+		out[2] = (colours[i] >> 16) & 0xFF; // red channel
+		out += 3;
+	}
+}
+
+#ifdef ESCAPE_KERNEL_X86
+#if defined(_MSC_VER)
+#define PALETTE_TARGET
+#else
+#define PALETTE_TARGET __attribute__((target("ssse3")))
+#endif
+
+// 16 colours at a time - every shuffle drops the unused top byte of 4 colours (12 BGR bytes),
+// the four results are then merged into three 16 byte stores
+PALETTE_TARGET static void pack_bgr_ssse3(const uint32_t * colours, unsigned n, uint8_t * out)
+{
+	const __m128i drop_top_byte = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+	unsigned i = 0;
+	for (; i + 16 <= n; i += 16)
+	{
+		const __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(colours + i)), drop_top_byte);
+		const __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(colours + i + 4)), drop_top_byte);
+		const __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(colours + i + 8)), drop_top_byte);
+		const __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(colours + i + 12)), drop_top_byte);
+		_mm_storeu_si128((__m128i *)(out), _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+		_mm_storeu_si128((__m128i *)(out + 16), _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+		_mm_storeu_si128((__m128i *)(out + 32), _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+		out += 48;
+	}
+	pack_bgr_scalar(colours + i, n - i, out);
+}
+#endif
+
+Palette::Palette(ThreadPool& pool) :
+	pool_(&pool),
+	pack_(pack_bgr_scalar),
+	milliseconds_(0.0)
+{
+#ifdef ESCAPE_KERNEL_X86
+	if (detect_ssse3()) { pack_ = pack_bgr_ssse3; }
+#endif
+	// one block of colours per worker, allocated once
+	blocks_.resize(pool_->size() * PALETTE_BLOCK * PALETTE_BLOCK);
+}
+
+void Palette::build(unsigned max_iter, unsigned r, unsigned g, unsigned b, unsigned offset)
+{
+	table_.resize(max_iter + 1);
+	for (unsigned iterations = 0; iterations < max_iter; ++iterations)
+	{
+		// max_iter + 1 never matches, so shifted counts are always coloured as escaped
+		table_[iterations] = amp_mandelbrot_colour(iterations + offset, max_iter + offset + 1, r, g, b);
+	}
+	table_[max_iter] = amp_mandelbrot_colour(max_iter, max_iter, r, g, b);
+}
+
+void Palette::apply(const uint32_t * iterations, unsigned width, unsigned height, uint8_t * pixel)
+{
+	const uint32_t * table = table_.data();
+	uint32_t * blocks = blocks_.data();
+	const PackFunction pack = pack_;
+	const unsigned bands = (height + PALETTE_BLOCK - 1) / PALETTE_BLOCK;
+
+	auto start = std::chrono::steady_clock::now();
+	pool_->run(bands, [=](unsigned band, unsigned worker)
+	{
+		uint32_t * block = blocks + worker * PALETTE_BLOCK * PALETTE_BLOCK;
+		const unsigned y0 = band * PALETTE_BLOCK;
+		const unsigned rows = y0 + PALETTE_BLOCK < height ? PALETTE_BLOCK : height - y0;
+		for (unsigned x0 = 0; x0 < width; x0 += PALETTE_BLOCK)
+		{
+			const unsigned columns = x0 + PALETTE_BLOCK < width ? PALETTE_BLOCK : width - x0;
+			// the counts of a column are contiguous - look up their colours
+			// and store them transposed (block[row * PALETTE_BLOCK + column])
+			for (unsigned x = 0; x < columns; ++x)
+			{
+				const uint32_t * column = iterations + (x0 + x) * height + y0;
+				for (unsigned y = 0; y < rows; ++y)
+				{
+					block[y * PALETTE_BLOCK + x] = table[column[y]];
+				}
+			}
+			// then pack every row of the block into BGR bytes
+			for (unsigned y = 0; y < rows; ++y)
+			{
+				pack(block + y * PALETTE_BLOCK, columns, pixel + ((y0 + y) * width + x0) * 3);
+			}
+		}
+	});
+	auto end = std::chrono::steady_clock::now();
+	milliseconds_ = std::chrono::duration<double, std::milli>(end - start).count();
+}
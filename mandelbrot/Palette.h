@@ -0,0 +1,48 @@
+// Palette class
+// Turns the escape counts stored by amp_mandelbrot and cpu_mandelbrot into the BGR pixels of the texture.
+// The colour of every count is looked up in a table built once per frame,
+// so changing the colours or cycling the palette doesn't recalculate the Mandelbrot set.
+// The counts are stored column by column and the pixels row by row, so apply() transposes
+// them in small blocks and packs every row of a block into BGR bytes with SSSE3 shuffles.
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.h"
+
+// colour of a pixel as calculated by amp_mandelbrot (0x00RRGGBB)
+inline uint32_t amp_mandelbrot_colour(unsigned iterations, unsigned max_iter, unsigned r, unsigned g, unsigned b)
+{
+	if (iterations != max_iter)
+	{
+		// z escaped within less than max_iter iterations. This point isn't in the set.
+		r = iterations * iterations * r;
+		g = iterations * iterations * g;
+		b = iterations * iterations * b;
+	}
+	return (r << 16) | (g << 8) | (b);
+}
+
+class Palette
+{
+public:
+	// runs on the workers of pool (the pool shared by the whole process by default)
+	Palette(ThreadPool& pool = ThreadPool::shared());
+	// build the colour table for counts 0 ... max_iter
+	// offset shifts the colours of the points outside the set (palette cycling)
+	void build(unsigned max_iter, unsigned r, unsigned g, unsigned b, unsigned offset);
+	// convert column ordered escape counts (iterations[x * height + y]) into row ordered BGR pixels
+	void apply(const uint32_t * iterations, unsigned width, unsigned height, uint8_t * pixel);
+	// time the last apply() took
+	double milliseconds() const { return milliseconds_; }
+private:
+	// writes n 0x00RRGGBB colours as 3 * n BGR bytes
+	typedef void(*PackFunction)(const uint32_t * colours, unsigned n, uint8_t * out);
+
+	ThreadPool * pool_;
+	PackFunction pack_;
+	// 0x00RRGGBB colour of every escape count
+	std::vector<uint32_t> table_;
+	// transposed block of colours of every worker
+	std::vector<uint32_t> blocks_;
+	double milliseconds_;
+};
@@ -0,0 +1,163 @@
+#include "TextureStream.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// OpenGL 1.2 - missing from the OpenGL 1.1 headers of Windows
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+// OpenGL 1.5 buffer objects - Windows only exports OpenGL 1.1, so they are looked up at run time
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+#ifndef GL_STREAM_DRAW
+#define GL_STREAM_DRAW 0x88E0
+#endif
+#ifndef GL_WRITE_ONLY
+#define GL_WRITE_ONLY 0x88B9
+#endif
+
+typedef void (APIENTRY * GenBuffersProc)(GLsizei n, GLuint * buffers);
+typedef void (APIENTRY * DeleteBuffersProc)(GLsizei n, const GLuint * buffers);
+typedef void (APIENTRY * BindBufferProc)(GLenum target, GLuint buffer);
+typedef void (APIENTRY * BufferDataProc)(GLenum target, std::ptrdiff_t size, const void * data, GLenum usage);
+typedef void * (APIENTRY * MapBufferProc)(GLenum target, GLenum access);
+typedef GLboolean (APIENTRY * UnmapBufferProc)(GLenum target);
+
+static GenBuffersProc gen_buffers = nullptr;
+static DeleteBuffersProc delete_buffers = nullptr;
+static BindBufferProc bind_buffer = nullptr;
+static BufferDataProc buffer_data = nullptr;
+static MapBufferProc map_buffer = nullptr;
+static UnmapBufferProc unmap_buffer = nullptr;
+
+// needs a current OpenGL context
+static bool load_buffer_functions()
+{
+	static bool loaded = false;
+	if (!loaded)
+	{
+		loaded = true;
+		gen_buffers = (GenBuffersProc)glutGetProcAddress("glGenBuffers");
+		delete_buffers = (DeleteBuffersProc)glutGetProcAddress("glDeleteBuffers");
+		bind_buffer = (BindBufferProc)glutGetProcAddress("glBindBuffer");
+		buffer_data = (BufferDataProc)glutGetProcAddress("glBufferData");
+		map_buffer = (MapBufferProc)glutGetProcAddress("glMapBuffer");
+		unmap_buffer = (UnmapBufferProc)glutGetProcAddress("glUnmapBuffer");
+	}
+	return gen_buffers && delete_buffers && bind_buffer && buffer_data && map_buffer && unmap_buffer;
+}
+
+static std::size_t type_size(GLenum type)
+{
+	switch (type)
+	{
+	case GL_UNSIGNED_BYTE: case GL_BYTE: return 1;
+	case GL_UNSIGNED_SHORT: case GL_SHORT: return 2;
+	default: return 4;
+	}
+}
+
+TextureStream::TextureStream(GLenum format, GLenum type) :
+	width_(0),
+	height_(0),
+	format_(format),
+	type_(type),
+	pixel_bytes_((format == GL_BGRA_EXT || format == GL_RGBA ? 4 : 3) * type_size(type)),
+	bytes_(0),
+	created_(false),
+	max_size_(0),
+	texture_(0),
+	next_pbo_(0),
+	generation_(0),
+	upload_ms_(0.0)
+{
+	pbo_[0] = pbo_[1] = 0;
+}
+
+TextureStream::~TextureStream()
+{
+	if (!created_) { return; }
+	if (pbo_[0]) { delete_buffers(2, pbo_); }
+	glDeleteTextures(1, &texture_);
+}
+
+// allocate the texture (and the pixel buffer objects) the first time a frame is uploaded
+void TextureStream::create()
+{
+	created_ = true;
+	glGenTextures(1, &texture_);
+	glBindTexture(GL_TEXTURE_2D, texture_);
+	// a frame reprojected onto a wider view repeats its edge instead of the whole frame
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size_);
+
+	// the buffers get their storage when the first frame is uploaded
+	if (load_buffer_functions())
+	{
+		gen_buffers(2, pbo_);
+	}
+}
+
+void TextureStream::resize(GLsizei width, GLsizei height)
+{
+	width_ = width;
+	height_ = height;
+	bytes_ = std::size_t(width) * height * pixel_bytes_;
+	glBindTexture(GL_TEXTURE_2D, texture_);
+	glTexImage2D(GL_TEXTURE_2D, 0, 3, width_, height_, 0, format_, type_, nullptr);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool TextureStream::update(unsigned long generation, GLsizei width, GLsizei height, const void * pixels)
+{
+	if (created_ && generation == generation_) { return false; }
+	if (!created_) { create(); }
+	if (width > max_size_ || height > max_size_)
+	{
+		// e.g. frames rendered at 16k for timing - calculated but not displayed
+		std::cout << "Frame " << width << "x" << height << " is larger than the largest texture ("
+			<< max_size_ << "x" << max_size_ << "), it isn't displayed" << std::endl;
+		generation_ = generation;
+		return false;
+	}
+	if (width != width_ || height != height_) { resize(width, height); }
+
+	auto start = std::chrono::steady_clock::now();
+	glBindTexture(GL_TEXTURE_2D, texture_);
+	// BGR rows are only 4 byte aligned when the width is a multiple of 4
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	bool uploaded = false;
+	if (pbo_[0])
+	{
+		bind_buffer(GL_PIXEL_UNPACK_BUFFER, pbo_[next_pbo_]);
+		// orphan the old storage so mapping doesn't wait for a transfer still reading it
+		// (this also gives the buffer the size of the new frame)
+		buffer_data(GL_PIXEL_UNPACK_BUFFER, (std::ptrdiff_t)bytes_, nullptr, GL_STREAM_DRAW);
+		void * buffer = map_buffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+		if (buffer)
+		{
+			std::memcpy(buffer, pixels, bytes_);
+			unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+			// with a buffer bound the last argument is an offset into it - the transfer runs asynchronously
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format_, type_, nullptr);
+			uploaded = true;
+		}
+		bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		next_pbo_ = 1 - next_pbo_;
+	}
+	if (!uploaded)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, format_, type_, pixels);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	generation_ = generation;
+	upload_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
@@ -0,0 +1,40 @@
+// TextureStream class
+// One texture that is allocated once (and again when the frame size changes) and updated in place with glTexSubImage2D.
+// New frames are streamed through two pixel buffer objects used in turn: the frame is copied into one
+// while the driver may still be transferring the previous one out of the other, so the copy never waits on the GPU.
+// Uploads are skipped while the frame generation doesn't change.
+// Without pixel buffer objects (OpenGL < 1.5) the pixels are uploaded straight from memory.
+#pragma once
+#include <freeglut.h>
+#include <cstddef>
+
+class TextureStream
+{
+public:
+	// format and type of the pixels, e.g. GL_BGR_EXT and GL_UNSIGNED_BYTE
+	TextureStream(GLenum format, GLenum type);
+	~TextureStream();
+	// upload the width x height pixels of a frame unless that generation is already in the texture
+	// returns true if the texture was updated (frames larger than GL_MAX_TEXTURE_SIZE are skipped)
+	bool update(unsigned long generation, GLsizei width, GLsizei height, const void * pixels);
+	GLuint texture() const { return texture_; }
+	// CPU time the last upload took
+	double upload_ms() const { return upload_ms_; }
+private:
+	void create();
+	// reallocate the texture for a new frame size
+	void resize(GLsizei width, GLsizei height);
+	GLsizei width_;
+	GLsizei height_;
+	GLenum format_;
+	GLenum type_;
+	std::size_t pixel_bytes_;
+	std::size_t bytes_;
+	bool created_;
+	GLint max_size_;
+	GLuint texture_;
+	GLuint pbo_[2];
+	unsigned next_pbo_;
+	unsigned long generation_;
+	double upload_ms_;
+};
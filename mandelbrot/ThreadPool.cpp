@@ -0,0 +1,154 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned thread_count) :
+	task_(nullptr),
+	schedule_(SCHEDULE_WORK_STEALING),
+	generation_(0),
+	busy_(0),
+	quit_(false)
+{
+	if (thread_count == 0) { thread_count = std::thread::hardware_concurrency(); }
+	if (thread_count == 0) { thread_count = 1; }
+	stats_.workers.resize(thread_count);
+	stats_.run_ms = 0.0;
+	stats_.steals = 0;
+	stats_.idle_ms = 0.0;
+	for (unsigned i = 0; i < thread_count; ++i)
+	{
+		queues_.push_back(std::unique_ptr<TaskQueue>(new TaskQueue));
+		queues_.back()->begin = 0;
+		queues_.back()->end = 0;
+	}
+	for (unsigned i = 0; i < thread_count; ++i)
+	{
+		workers_.push_back(std::thread(&ThreadPool::worker_loop, this, i));
+	}
+}
+
+ThreadPool& ThreadPool::shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		quit_ = true;
+	}
+	start_.notify_all();
+	for (auto& worker : workers_)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::run(unsigned task_count, const Task& task)
+{
+	if (task_count == 0) { return; }
+	std::unique_lock<std::mutex> lock(mutex_);
+	// split the tasks into one contiguous range per worker
+	for (unsigned i = 0; i < size(); ++i)
+	{
+		std::lock_guard<std::mutex> queue_lock(queues_[i]->mutex);
+		queues_[i]->begin = (unsigned)((unsigned long long)task_count * i / size());
+		queues_[i]->end = (unsigned)((unsigned long long)task_count * (i + 1) / size());
+	}
+	for (auto& worker : stats_.workers)
+	{
+		worker = WorkerStats{ 0, 0, 0.0, 0.0 };
+	}
+	task_ = &task;
+	busy_ = size();
+	run_start_ = clock::now();
+	++generation_;
+	start_.notify_all();
+	// wait for every worker to finish its share of the tasks
+	done_.wait(lock, [this]() { return busy_ == 0; });
+	task_ = nullptr;
+
+	stats_.run_ms = std::chrono::duration<double, std::milli>(clock::now() - run_start_).count();
+	stats_.steals = 0;
+	stats_.idle_ms = 0.0;
+	for (auto& worker : stats_.workers)
+	{
+		stats_.steals += worker.steals;
+		stats_.idle_ms += stats_.run_ms - worker.finish_ms;
+	}
+}
+
+// take the next task from the worker's own range
+bool ThreadPool::pop(unsigned worker, unsigned& task)
+{
+	TaskQueue& queue = *queues_[worker];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.begin == queue.end) { return false; }
+	task = queue.begin++;
+	return true;
+}
+
+// move the back half of another worker's range into this worker's (empty) range
+bool ThreadPool::steal(unsigned worker)
+{
+	for (unsigned i = 1; i < size(); ++i)
+	{
+		TaskQueue& victim = *queues_[(worker + i) % size()];
+		unsigned begin, end;
+		{
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			const unsigned remaining = victim.end - victim.begin;
+			if (remaining == 0) { continue; }
+			begin = victim.end - (remaining + 1) / 2;
+			end = victim.end;
+			victim.end = begin;
+		}
+		TaskQueue& queue = *queues_[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.begin = begin;
+		queue.end = end;
+		return true;
+	}
+	return false;
+}
+
+void ThreadPool::worker_loop(unsigned worker)
+{
+	unsigned long seen_generation = 0;
+	for (;;)
+	{
+		const Task * task;
+		SCHEDULE schedule;
+		clock::time_point run_start;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			start_.wait(lock, [&]() { return quit_ || generation_ != seen_generation; });
+			if (quit_) { return; }
+			seen_generation = generation_;
+			task = task_;
+			schedule = schedule_;
+			run_start = run_start_;
+		}
+		WorkerStats& stats = stats_.workers[worker];
+		for (;;)
+		{
+			unsigned i;
+			if (!pop(worker, i))
+			{
+				// static split - a worker stops once its own range is done
+				if (schedule == SCHEDULE_STATIC || !steal(worker)) { break; }
+				++stats.steals;
+				continue;
+			}
+			const clock::time_point start = clock::now();
+			(*task)(i, worker);
+			stats.busy_ms += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			++stats.tasks;
+		}
+		stats.finish_ms = std::chrono::duration<double, std::milli>(clock::now() - run_start).count();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--busy_ == 0) { done_.notify_one(); }
+		}
+	}
+}
@@ -0,0 +1,109 @@
+// ThreadPool class
+// Persistent pool of worker threads used by the CPU Mandelbrot engine.
+// Workers are created once and sleep between frames, so rendering a frame
+// does not pay for spawning threads (nor for a heap allocated copy of the task).
+// Tasks are scheduled with per-worker deques: every worker starts with a contiguous
+// range of tasks and, once it runs out, steals half of the remaining range of another worker.
+// The static schedule (no stealing) is kept to compare against.
+// The CPU engines using every hardware thread, the Palette and the C++ AMP emulation share one pool,
+// which is safe because all of them run on the compute thread, one after the other.
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <chrono>
+
+enum SCHEDULE
+{
+	SCHEDULE_STATIC,
+	SCHEDULE_WORK_STEALING,
+};
+
+// what a worker did during the last run()
+struct WorkerStats
+{
+	unsigned tasks;   // number of tasks it ran
+	unsigned steals;  // number of successful steals from other workers
+	double busy_ms;   // time spent running tasks
+	double finish_ms; // time from the start of run() until it ran out of work
+};
+
+// statistics of the last run()
+struct PoolStats
+{
+	std::vector<WorkerStats> workers;
+	double run_ms;    // wall clock time of the whole run()
+	unsigned steals;  // total number of steals
+	double idle_ms;   // sum over workers of the time they waited for the last worker to finish
+};
+
+inline const char * schedule_name(SCHEDULE schedule)
+{
+	return schedule == SCHEDULE_STATIC ? "static" : "work stealing";
+}
+
+class ThreadPool
+{
+public:
+	// task to run - receives the task number and the number of the worker running it
+	// Only refers to the caller's function object: run() returns once every task has finished,
+	// so the object outlives the workers' calls and nothing has to be copied onto the heap.
+	class Task
+	{
+	public:
+		template <class Function>
+		Task(const Function& function) : function_(&function), call_(&call<Function>) {}
+		void operator()(unsigned task, unsigned worker) const { call_(function_, task, worker); }
+	private:
+		template <class Function>
+		static void call(const void * function, unsigned task, unsigned worker)
+		{
+			(*static_cast<const Function *>(function))(task, worker);
+		}
+		const void * function_;
+		void (*call_)(const void * function, unsigned task, unsigned worker);
+	};
+
+	// thread_count == 0 uses every hardware thread
+	ThreadPool(unsigned thread_count = 0);
+	~ThreadPool();
+	// pool of every hardware thread shared by the whole process (created on first use)
+	static ThreadPool& shared();
+	// run task(0) ... task(task_count - 1) on all workers and wait until all of them are finished
+	void run(unsigned task_count, const Task& task);
+	// number of worker threads
+	unsigned size() const { return (unsigned)workers_.size(); }
+	void set_schedule(SCHEDULE schedule) { schedule_ = schedule; }
+	SCHEDULE schedule() const { return schedule_; }
+	const PoolStats& stats() const { return stats_; }
+private:
+	typedef std::chrono::steady_clock clock;
+	// range of tasks [begin, end) still owned by a worker
+	// the owner takes tasks from the front, thieves take the back half
+	struct TaskQueue
+	{
+		std::mutex mutex;
+		unsigned begin;
+		unsigned end;
+	};
+	void worker_loop(unsigned worker);
+	bool pop(unsigned worker, unsigned& task);
+	bool steal(unsigned worker);
+	std::vector<std::thread> workers_;
+	std::vector<std::unique_ptr<TaskQueue>> queues_;
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable done_;
+	// current job
+	const Task * task_;
+	SCHEDULE schedule_;
+	clock::time_point run_start_;
+	// incremented every time run() hands out a new job
+	unsigned long generation_;
+	// number of workers still working on the current job
+	unsigned busy_;
+	bool quit_;
+	PoolStats stats_;
+};
@@ -0,0 +1,121 @@
+#include "TileCache.h"
+#include <cmath>
+
+// memory a tile takes
+static const std::size_t TILE_BYTES = TileCache::TILE * TileCache::TILE * sizeof(uint32_t);
+
+double TileCache::level_step(int level)
+{
+	return std::ldexp(1.0 / TILE, -level);
+}
+
+int TileCache::level_for(double step)
+{
+	// the tolerance keeps steps that are exactly a level's step on that level
+	return (int)std::ceil(std::log2(level_step(0) / step) - 1.0e-6);
+}
+
+TileCache::TileCache(std::size_t budget) :
+	age_(0.0),
+	budget_(budget),
+	stats_()
+{
+}
+
+const uint32_t * TileCache::find(const Key& key, unsigned max_iter)
+{
+	auto found = tiles_.find(key);
+	if (found == tiles_.end() || !found->second.committed || found->second.max_iter < max_iter)
+	{
+		++stats_.misses;
+		++stats_.frame_misses;
+		return nullptr;
+	}
+	++stats_.hits;
+	++stats_.frame_hits;
+	touch(found->second, key);
+	return found->second.counts.data();
+}
+
+uint32_t * TileCache::insert(const Key& key, unsigned max_iter)
+{
+	auto inserted = tiles_.emplace(key, Tile());
+	Tile& tile = inserted.first->second;
+	if (inserted.second)
+	{
+		tile.counts.resize(TILE * TILE);
+		tile.priority = priorities_.end();
+	}
+	else if (tile.priority != priorities_.end())
+	{
+		// calculated again with more iterations - not evicted until it's committed again
+		priorities_.erase(tile.priority);
+		tile.priority = priorities_.end();
+	}
+	tile.max_iter = max_iter;
+	tile.cost = 0.0;
+	tile.committed = false;
+	return tile.counts.data();
+}
+
+void TileCache::commit(const Key& key, double cost)
+{
+	auto found = tiles_.find(key);
+	if (found == tiles_.end()) { return; }
+	found->second.cost = cost / (TILE * TILE);
+	found->second.committed = true;
+	touch(found->second, key);
+}
+
+void TileCache::erase(const Key& key)
+{
+	auto found = tiles_.find(key);
+	if (found == tiles_.end()) { return; }
+	if (found->second.priority != priorities_.end()) { priorities_.erase(found->second.priority); }
+	tiles_.erase(found);
+}
+
+void TileCache::touch(Tile& tile, const Key& key)
+{
+	if (tile.priority != priorities_.end()) { priorities_.erase(tile.priority); }
+	// one iteration per point is the least a tile can cost
+	tile.priority = priorities_.emplace(age_ + 1.0 + tile.cost, key);
+}
+
+void TileCache::trim()
+{
+	// tiles still being calculated have no priority and are never evicted
+	while (tiles_.size() * TILE_BYTES > budget_ && !priorities_.empty())
+	{
+		auto lowest = priorities_.begin();
+		age_ = lowest->first;
+		tiles_.erase(lowest->second);
+		priorities_.erase(lowest);
+		++stats_.evictions;
+		++stats_.frame_evictions;
+	}
+}
+
+void TileCache::clear()
+{
+	// the counters are kept
+	std::unordered_map<Key, Tile, KeyHash>().swap(tiles_);
+	priorities_.clear();
+	age_ = 0.0;
+}
+
+void TileCache::start_frame()
+{
+	stats_.frame_hits = 0;
+	stats_.frame_misses = 0;
+	stats_.frame_evictions = 0;
+}
+
+TileCacheStats TileCache::stats() const
+{
+	TileCacheStats stats = stats_;
+	stats.tiles = tiles_.size();
+	stats.bytes = tiles_.size() * TILE_BYTES;
+	stats.budget = budget_;
+	return stats;
+}
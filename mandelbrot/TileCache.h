@@ -0,0 +1,87 @@
+// TileCache class
+// Escape counts of square tiles on a quadtree grid of the complex plane, kept between frames so moving
+// back to a view doesn't calculate it again. A tile of level L is TILE x TILE points LEVEL0_STEP / 2^L apart,
+// keyed by its level and position on that level's grid.
+// When the memory budget is exceeded the tiles are evicted by cost-aware LRU (GreedyDual): a tile's priority
+// is the age of the cache when it was last used plus the iterations per point it took to calculate,
+// so expensive tiles on the boundary of the set survive longer than cheap ones far outside it.
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+// hits, misses and evictions of the tile cache
+struct TileCacheStats
+{
+	unsigned long hits, misses, evictions;              // since the cache was created
+	unsigned frame_hits, frame_misses, frame_evictions; // since start_frame()
+	std::size_t tiles;                                  // tiles held
+	std::size_t bytes;                                  // memory they take
+	std::size_t budget;                                 // memory they may take
+};
+
+class TileCache
+{
+public:
+	// points per side of a tile
+	static const unsigned TILE = 64;
+	// distance between the points of a level 0 tile (a level 0 tile covers 1 x 1 of the complex plane)
+	static double level_step(int level);
+	// finest level whose points are at most step apart
+	static int level_for(double step);
+
+	struct Key
+	{
+		int level;
+		int64_t x, y; // tile x covers the points x * TILE ... x * TILE + TILE - 1 of the level's grid
+		bool operator==(const Key& other) const { return level == other.level && x == other.x && y == other.y; }
+	};
+
+	TileCache(std::size_t budget = std::size_t(256) * 1024 * 1024);
+	// escape counts of the tile (counts[i * TILE + j] for point (x * TILE + i, y * TILE + j)) if it was calculated
+	// with at least max_iter iterations, nullptr otherwise - counted as a hit or a miss
+	const uint32_t * find(const Key& key, unsigned max_iter);
+	// storage for a tile about to be calculated (replaces a tile calculated with fewer iterations)
+	// the tile is only used once it was committed
+	uint32_t * insert(const Key& key, unsigned max_iter);
+	// the tile was calculated - cost is the number of iterations it took
+	void commit(const Key& key, double cost);
+	// throw away a tile that was inserted but not committed (its frame was cancelled)
+	void erase(const Key& key);
+	// evict tiles until the cache fits in its budget
+	void trim();
+	void set_budget(std::size_t budget) { budget_ = budget; }
+	// throw away every tile (e.g. the escape radius changed)
+	void clear();
+	// reset the per frame counters
+	void start_frame();
+	TileCacheStats stats() const;
+private:
+	struct KeyHash
+	{
+		std::size_t operator()(const Key& key) const
+		{
+			return std::hash<uint64_t>()(uint64_t(key.x) * 73856093u ^ uint64_t(key.y) * 19349663u ^ uint64_t(key.level) * 83492791u);
+		}
+	};
+	typedef std::multimap<double, Key> Priorities;
+	struct Tile
+	{
+		std::vector<uint32_t> counts;
+		unsigned max_iter;
+		double cost;                  // iterations per point
+		bool committed;
+		Priorities::iterator priority;
+	};
+	// give the tile a new priority (it was used or calculated)
+	void touch(Tile& tile, const Key& key);
+	std::unordered_map<Key, Tile, KeyHash> tiles_;
+	// tiles by priority, the next one to evict first
+	Priorities priorities_;
+	// priority of the last tile evicted - ages the tiles that aren't used
+	double age_;
+	std::size_t budget_;
+	TileCacheStats stats_;
+};
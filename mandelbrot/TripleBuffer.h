@@ -0,0 +1,42 @@
+// TripleBuffer class
+// Hands finished frames from the compute thread to the GLUT display thread.
+// The producer always has a back buffer to write into and the consumer always has a front buffer
+// to draw from, so neither of them ever waits for the other - only the indices are swapped under the lock.
+#pragma once
+#include <mutex>
+#include <utility>
+
+template <class T>
+class TripleBuffer
+{
+public:
+	TripleBuffer() : back_(0), middle_(1), front_(2), fresh_(false) {}
+	// producer - buffer to write the next frame into
+	T& back() { return buffers_[back_]; }
+	// producer - the back buffer is finished, it becomes the newest frame
+	void publish()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::swap(back_, middle_);
+		fresh_ = true;
+	}
+	// consumer - take the newest published frame (false if nothing was published since the last call)
+	bool acquire()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!fresh_) { return false; }
+		std::swap(front_, middle_);
+		fresh_ = false;
+		return true;
+	}
+	// consumer - frame to draw
+	const T& front() const { return buffers_[front_]; }
+private:
+	T buffers_[3];
+	unsigned back_;
+	unsigned middle_;
+	unsigned front_;
+	// the middle buffer holds a frame the consumer hasn't taken yet
+	bool fresh_;
+	std::mutex mutex_;
+};
@@ -0,0 +1,605 @@
+// CPU emulation of the subset of C++ AMP (<amp.h> and <amp_math.h>) used by the Mandelbrot kernels.
+// <amp.h> only exists with Visual C++, this header lets the same kernel source build and run
+// multithreaded with GCC/Clang on Linux.
+// Emulated: extent, index, tiled_extent, tiled_index, array, array_view, accelerator, accelerator_view,
+// parallel_for_each, tile_static, tile_barrier and fast_math::sqrt.
+// Tiles are spread over the ThreadPool workers. The threads of one tile run as fibers on a single worker,
+// so tile_static variables are simply thread_local statics shared by the fibers of the tile and
+// tile_barrier::wait switches to the next fiber of the tile until all of them reached the barrier.
+// Kernels which never wait on a barrier are detected on the first tile and run without fibers.
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include <exception>
+#include <mutex>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "ThreadPool.h"
+
+#if !defined(__x86_64__)
+#include <ucontext.h>
+#endif
+
+// restrict(amp) / restrict(cpu, amp) - every function runs on the CPU
+#define restrict(...)
+// memory shared by all threads of a tile - the fibers of a tile all run on the same worker thread
+#define tile_static static thread_local
+
+namespace concurrency
+{
+	class runtime_exception : public std::runtime_error
+	{
+	public:
+		explicit runtime_exception(const char * message, long error_code = 0) : std::runtime_error(message), error_code_(error_code) {}
+		long get_error_code() const { return error_code_; }
+	private:
+		long error_code_;
+	};
+
+	class accelerator_view_removed : public runtime_exception
+	{
+	public:
+		explicit accelerator_view_removed(const char * message, long reason = 0) : runtime_exception(message, reason) {}
+		long get_view_removed_reason() const { return get_error_code(); }
+	};
+
+	class invalid_compute_domain : public runtime_exception
+	{
+	public:
+		explicit invalid_compute_domain(const char * message) : runtime_exception(message) {}
+	};
+
+	template <int N>
+	class index
+	{
+	public:
+		static const int rank = N;
+		index() { for (int i = 0; i < N; ++i) { v_[i] = 0; } }
+		explicit index(int i0) { static_assert(N == 1, "index rank"); v_[0] = i0; }
+		index(int i0, int i1) { static_assert(N == 2, "index rank"); v_[0] = i0; v_[1] = i1; }
+		index(int i0, int i1, int i2) { static_assert(N == 3, "index rank"); v_[0] = i0; v_[1] = i1; v_[2] = i2; }
+		int operator[](unsigned i) const { return v_[i]; }
+		int& operator[](unsigned i) { return v_[i]; }
+		index& operator+=(const index& other) { for (int i = 0; i < N; ++i) { v_[i] += other.v_[i]; } return *this; }
+		friend index operator+(index a, const index& b) { return a += b; }
+		friend bool operator==(const index& a, const index& b) { for (int i = 0; i < N; ++i) { if (a.v_[i] != b.v_[i]) { return false; } } return true; }
+		friend bool operator!=(const index& a, const index& b) { return !(a == b); }
+	private:
+		int v_[N];
+	};
+
+	template <int D0, int D1 = 0, int D2 = 0> class tiled_extent;
+
+	template <int N>
+	class extent
+	{
+	public:
+		static const int rank = N;
+		extent() { for (int i = 0; i < N; ++i) { v_[i] = 0; } }
+		explicit extent(int e0) { static_assert(N == 1, "extent rank"); v_[0] = e0; }
+		extent(int e0, int e1) { static_assert(N == 2, "extent rank"); v_[0] = e0; v_[1] = e1; }
+		extent(int e0, int e1, int e2) { static_assert(N == 3, "extent rank"); v_[0] = e0; v_[1] = e1; v_[2] = e2; }
+		int operator[](unsigned i) const { return v_[i]; }
+		int& operator[](unsigned i) { return v_[i]; }
+		unsigned size() const { unsigned s = 1; for (int i = 0; i < N; ++i) { s *= v_[i]; } return s; }
+		// linear offset of an index (row major, like C++ AMP)
+		unsigned offset(const index<N>& idx) const { unsigned o = 0; for (int i = 0; i < N; ++i) { o = o * v_[i] + idx[i]; } return o; }
+		template <int T0> tiled_extent<T0> tile() const { static_assert(N == 1, "extent rank"); return tiled_extent<T0>(*this); }
+		template <int T0, int T1> tiled_extent<T0, T1> tile() const { static_assert(N == 2, "extent rank"); return tiled_extent<T0, T1>(*this); }
+	private:
+		int v_[N];
+	};
+
+	template <int D0, int D1>
+	class tiled_extent<D0, D1, 0> : public extent<2>
+	{
+	public:
+		static const int tile_dim0 = D0;
+		static const int tile_dim1 = D1;
+		explicit tiled_extent(const extent<2>& e) : extent<2>(e) {}
+		// rounded up to a whole number of tiles
+		tiled_extent pad() const { return tiled_extent(extent<2>(((*this)[0] + D0 - 1) / D0 * D0, ((*this)[1] + D1 - 1) / D1 * D1)); }
+	};
+
+	template <int D0>
+	class tiled_extent<D0, 0, 0> : public extent<1>
+	{
+	public:
+		static const int tile_dim0 = D0;
+		explicit tiled_extent(const extent<1>& e) : extent<1>(e) {}
+		// rounded up to a whole number of tiles
+		tiled_extent pad() const { return tiled_extent(extent<1>(((*this)[0] + D0 - 1) / D0 * D0)); }
+	};
+
+	namespace details
+	{
+		// Runs the threads of one tile as fibers on the calling thread.
+		// A fiber gives control back to the scheduler when it waits on the tile barrier or finishes,
+		// the scheduler resumes the fibers in passes, so every fiber reaches barrier n before any passes it.
+		class TileFibers
+		{
+		public:
+			typedef void(*Body)(void * context, unsigned thread);
+			TileFibers() : current_(0), body_(nullptr), context_(nullptr), barrier_used_(false) {}
+
+			// run body(context, 0) ... body(context, count - 1), returns true if any of them waited on the barrier
+			bool run(unsigned count, Body body, void * context)
+			{
+				while (fibers_.size() < count) { fibers_.push_back(std::unique_ptr<Fiber>(new Fiber)); }
+				body_ = body;
+				context_ = context;
+				barrier_used_ = false;
+				error_ = nullptr;
+				for (unsigned i = 0; i < count; ++i) { start(*fibers_[i]); }
+				TileFibers * previous = active();
+				active() = this;
+				bool running = true;
+				while (running)
+				{
+					running = false;
+					for (unsigned i = 0; i < count; ++i)
+					{
+						if (fibers_[i]->finished) { continue; }
+						current_ = i;
+						resume(*fibers_[i]);
+						running = running || !fibers_[i]->finished;
+					}
+				}
+				active() = previous;
+				if (error_) { std::rethrow_exception(error_); }
+				return barrier_used_;
+			}
+
+			// called by a fiber - give control back to the scheduler until the whole tile reached the barrier
+			void wait()
+			{
+				barrier_used_ = true;
+				yield(*fibers_[current_]);
+			}
+
+			// scheduler of the tile running on this thread (nullptr when the tile runs without fibers)
+			static TileFibers *& active()
+			{
+				static thread_local TileFibers * scheduler = nullptr;
+				return scheduler;
+			}
+		private:
+			enum { STACK_SIZE = 64 * 1024 };
+			struct Fiber
+			{
+				Fiber() : stack(new char[STACK_SIZE]), finished(true) {}
+				std::unique_ptr<char[]> stack;
+				bool finished;
+#if defined(__x86_64__)
+				void * sp;
+#else
+				ucontext_t context;
+#endif
+			};
+
+			static void entry()
+			{
+				TileFibers& self = *active();
+				Fiber& fiber = *self.fibers_[self.current_];
+				try
+				{
+					self.body_(self.context_, self.current_);
+				}
+				catch (...)
+				{
+					self.error_ = std::current_exception();
+				}
+				fiber.finished = true;
+				self.yield(fiber);
+				// a finished fiber is never resumed
+			}
+
+#if defined(__x86_64__)
+			// save the callee-saved registers and the floating point control words (MXCSR and the x87 control word
+			// are callee-saved too) on the current stack, store the stack pointer in *save (rdi),
+			// switch to the stack load (rsi) and restore its control words and registers
+			__attribute__((naked, noinline)) static void switch_stack(void ** /*save*/, void * /*load*/)
+			{
+				__asm__ volatile(
+					"pushq %rbp\n\t"
+					"pushq %rbx\n\t"
+					"pushq %r12\n\t"
+					"pushq %r13\n\t"
+					"pushq %r14\n\t"
+					"pushq %r15\n\t"
+					"subq $8, %rsp\n\t"
+					"stmxcsr (%rsp)\n\t"
+					"fnstcw 4(%rsp)\n\t"
+					"movq %rsp, (%rdi)\n\t"
+					"movq %rsi, %rsp\n\t"
+					"ldmxcsr (%rsp)\n\t"
+					"fldcw 4(%rsp)\n\t"
+					"addq $8, %rsp\n\t"
+					"popq %r15\n\t"
+					"popq %r14\n\t"
+					"popq %r13\n\t"
+					"popq %r12\n\t"
+					"popq %rbx\n\t"
+					"popq %rbp\n\t"
+					"ret\n\t");
+			}
+
+			void start(Fiber& fiber)
+			{
+				// a new stack looks like a switch_stack frame returning into entry()
+				// (a fiber starts with the control words of the thread running the tile)
+				std::uint32_t mxcsr;
+				std::uint16_t control_word;
+				__asm__ volatile("stmxcsr %0" : "=m"(mxcsr));
+				__asm__ volatile("fnstcw %0" : "=m"(control_word));
+				void ** sp = (void **)(((std::size_t)(fiber.stack.get() + STACK_SIZE)) & ~(std::size_t)15);
+				*--sp = nullptr;         // return address of entry() - never used
+				*--sp = (void *)&entry;
+				for (int i = 0; i < 6; ++i) { *--sp = nullptr; } // rbp, rbx, r12 - r15
+				*--sp = (void *)(std::uintptr_t)(mxcsr | (std::uint64_t)control_word << 32);
+				fiber.sp = sp;
+				fiber.finished = false;
+			}
+			void resume(Fiber& fiber) { switch_stack(&scheduler_sp_, fiber.sp); }
+			void yield(Fiber& fiber) { switch_stack(&fiber.sp, scheduler_sp_); }
+			void * scheduler_sp_;
+#else
+			void start(Fiber& fiber)
+			{
+				getcontext(&fiber.context);
+				fiber.context.uc_stack.ss_sp = fiber.stack.get();
+				fiber.context.uc_stack.ss_size = STACK_SIZE;
+				fiber.context.uc_link = nullptr;
+				makecontext(&fiber.context, &entry, 0);
+				fiber.finished = false;
+			}
+			void resume(Fiber& fiber) { swapcontext(&scheduler_context_, &fiber.context); }
+			void yield(Fiber& fiber) { swapcontext(&fiber.context, &scheduler_context_); }
+			ucontext_t scheduler_context_;
+#endif
+			std::vector<std::unique_ptr<Fiber>> fibers_;
+			unsigned current_;
+			Body body_;
+			void * context_;
+			bool barrier_used_;
+			std::exception_ptr error_;
+		};
+
+		inline TileFibers& local_fibers()
+		{
+			static thread_local TileFibers fibers;
+			return fibers;
+		}
+
+		// thrown when a tile running without fibers waits on the barrier - the tile is run again with fibers
+		struct barrier_without_fibers {};
+
+		inline ThreadPool& pool()
+		{
+			return ThreadPool::shared();
+		}
+	}
+
+	class tile_barrier
+	{
+	public:
+		tile_barrier() {}
+		void wait() const
+		{
+			details::TileFibers * fibers = details::TileFibers::active();
+			if (fibers == nullptr) { throw details::barrier_without_fibers(); }
+			fibers->wait();
+		}
+		void wait_with_all_memory_fence() const { wait(); }
+		void wait_with_global_memory_fence() const { wait(); }
+		void wait_with_tile_static_memory_fence() const { wait(); }
+	};
+
+	template <int D0, int D1 = 0, int D2 = 0> class tiled_index;
+
+	template <int D0, int D1>
+	class tiled_index<D0, D1, 0>
+	{
+	public:
+		static const int rank = 2;
+		static const int tile_dim0 = D0;
+		static const int tile_dim1 = D1;
+		tiled_index(const index<2>& global_index, const index<2>& local_index, const index<2>& tile_index) :
+			global(global_index), local(local_index), tile(tile_index), tile_origin(global_index[0] - local_index[0], global_index[1] - local_index[1]) {}
+		operator const index<2>() const { return global; }
+		const index<2> global;
+		const index<2> local;
+		const index<2> tile;
+		const index<2> tile_origin;
+		const tile_barrier barrier;
+	};
+
+	template <int D0>
+	class tiled_index<D0, 0, 0>
+	{
+	public:
+		static const int rank = 1;
+		static const int tile_dim0 = D0;
+		tiled_index(const index<1>& global_index, const index<1>& local_index, const index<1>& tile_index) :
+			global(global_index), local(local_index), tile(tile_index), tile_origin(global_index[0] - local_index[0]) {}
+		operator const index<1>() const { return global; }
+		const index<1> global;
+		const index<1> local;
+		const index<1> tile;
+		const index<1> tile_origin;
+		const tile_barrier barrier;
+	};
+
+	class accelerator;
+
+	class accelerator_view
+	{
+	public:
+		void flush() {}
+		void wait() {}
+	};
+
+	class accelerator
+	{
+	public:
+		static constexpr const wchar_t * default_accelerator = L"default";
+		static constexpr const wchar_t * cpu_accelerator = L"cpu";
+		static constexpr const wchar_t * direct3d_warp = L"direct3d\\warp";
+		static constexpr const wchar_t * direct3d_ref = L"direct3d\\ref";
+
+		explicit accelerator(const std::wstring& path = default_accelerator) :
+			device_path(path == default_accelerator ? std::wstring(cpu_accelerator) : path),
+			description(L"CPU emulation of C++ AMP (" + std::to_wstring(details::pool().size()) + L" threads)"),
+			dedicated_memory(0),
+			has_display(false),
+			is_debug(false),
+			is_emulated(true),
+			supports_double_precision(true),
+			supports_limited_double_precision(true)
+		{
+		}
+		// the emulation is the only accelerator
+		static std::vector<accelerator> get_all() { return std::vector<accelerator>(1, accelerator()); }
+		friend bool operator==(const accelerator& a, const accelerator& b) { return a.device_path == b.device_path; }
+		friend bool operator!=(const accelerator& a, const accelerator& b) { return !(a == b); }
+
+		std::wstring device_path;
+		std::wstring description;
+		std::size_t dedicated_memory;
+		bool has_display;
+		bool is_debug;
+		bool is_emulated;
+		bool supports_double_precision;
+		bool supports_limited_double_precision;
+		accelerator_view default_view;
+	};
+
+	// wraps host memory - the kernels run on the CPU, so there is nothing to copy
+	template <typename T, int N = 1>
+	class array_view
+	{
+	public:
+		static const int rank = N;
+		template <typename Container>
+		array_view(const concurrency::extent<N>& e, Container& container) : extent(e), data_(container.data()) {}
+		array_view(const concurrency::extent<N>& e, T * data) : extent(e), data_(data) {}
+		template <typename Container>
+		array_view(int e0, Container& container) : extent(e0), data_(container.data()) {}
+
+		T& operator[](const index<N>& idx) const { return data_[extent.offset(idx)]; }
+		T& operator[](int i) const { static_assert(N == 1, "array_view rank"); return data_[i]; }
+		T& operator()(const index<N>& idx) const { return data_[extent.offset(idx)]; }
+		T& operator()(int i0, int i1) const { return data_[extent.offset(index<N>(i0, i1))]; }
+		T * data() const { return data_; }
+		void discard_data() const {}
+		void synchronize() const {}
+		void refresh() const {}
+
+		const concurrency::extent<N> extent;
+	private:
+		T * data_;
+	};
+
+	template <typename T, int N = 1>
+	class array
+	{
+	public:
+		static const int rank = N;
+		explicit array(const concurrency::extent<N>& e) : extent(e), data_(e.size()) {}
+		template <typename InputIterator>
+		array(const concurrency::extent<N>& e, InputIterator begin, InputIterator end) : extent(e), data_(begin, end) { data_.resize(e.size()); }
+		explicit array(int e0) : extent(e0), data_(e0) {}
+
+		T& operator[](const index<N>& idx) { return data_[extent.offset(idx)]; }
+		const T& operator[](const index<N>& idx) const { return data_[extent.offset(idx)]; }
+		T& operator[](int i) { static_assert(N == 1, "array rank"); return data_[i]; }
+		const T& operator[](int i) const { static_assert(N == 1, "array rank"); return data_[i]; }
+		T * data() { return data_.data(); }
+		operator std::vector<T>() const { return data_; }
+
+		const concurrency::extent<N> extent;
+	private:
+		std::vector<T> data_;
+	};
+
+	namespace details
+	{
+		// one C++ AMP thread - every thread gets its own copy of the kernel (captures are per thread in C++ AMP)
+		template <typename Kernel, typename TiledIndex>
+		struct TileContext
+		{
+			const Kernel * kernel;
+			const index<TiledIndex::rank> * tile_origin;
+			const index<TiledIndex::rank> * tile;
+			static index<TiledIndex::rank> local_index(unsigned thread);
+			static void body(void * context, unsigned thread)
+			{
+				const TileContext& self = *(const TileContext *)context;
+				const index<TiledIndex::rank> local = local_index(thread);
+				Kernel kernel(*self.kernel);
+				kernel(TiledIndex(*self.tile_origin + local, local, *self.tile));
+			}
+		};
+
+		template <int D0, int D1>
+		inline index<2> tiled_local_index(unsigned thread, const tiled_index<D0, D1> *) { return index<2>(thread / D1, thread % D1); }
+		template <int D0>
+		inline index<1> tiled_local_index(unsigned thread, const tiled_index<D0> *) { return index<1>(thread); }
+
+		template <typename Kernel, typename TiledIndex>
+		index<TiledIndex::rank> TileContext<Kernel, TiledIndex>::local_index(unsigned thread)
+		{
+			return tiled_local_index(thread, (const TiledIndex *)nullptr);
+		}
+
+		// run task(0) ... task(count - 1) on the pool - the first exception thrown by a task is rethrown
+		// on the calling thread once the pool is finished (the tasks not started yet are skipped)
+		template <typename Task>
+		void run_on_pool(unsigned count, const Task& task)
+		{
+			std::exception_ptr error;
+			std::mutex error_mutex;
+			std::atomic<bool> failed(false);
+			pool().run(count, [&](unsigned i, unsigned)
+			{
+				if (failed) { return; }
+				try
+				{
+					task(i);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) { error = std::current_exception(); }
+					failed = true;
+				}
+			});
+			if (error) { std::rethrow_exception(error); }
+		}
+
+		// run all tiles - the first tile tells whether the kernel needs fibers
+		template <typename Kernel, typename TiledIndex, int R>
+		void run_tiles(const extent<R>& e, const index<R>& tile_extent, unsigned threads_per_tile, const Kernel& kernel)
+		{
+			index<R> tiles;
+			unsigned tile_count = 1;
+			for (int i = 0; i < R; ++i)
+			{
+				if (e[i] % tile_extent[i] != 0) { throw invalid_compute_domain("extent is not divisible by the tile size"); }
+				tiles[i] = e[i] / tile_extent[i];
+				tile_count *= tiles[i];
+			}
+			std::atomic<bool> use_fibers(true);
+			auto run_tile = [&](unsigned tile_number)
+			{
+				index<R> tile;
+				index<R> origin;
+				for (int i = R - 1, t = tile_number; i >= 0; --i)
+				{
+					tile[i] = t % tiles[i];
+					origin[i] = tile[i] * tile_extent[i];
+					t /= tiles[i];
+				}
+				TileContext<Kernel, TiledIndex> context = { &kernel, &origin, &tile };
+				if (use_fibers)
+				{
+					return local_fibers().run(threads_per_tile, &TileContext<Kernel, TiledIndex>::body, &context);
+				}
+				try
+				{
+					for (unsigned thread = 0; thread < threads_per_tile; ++thread)
+					{
+						TileContext<Kernel, TiledIndex>::body(&context, thread);
+					}
+				}
+				catch (const barrier_without_fibers&)
+				{
+					// the barrier is only used by some tiles - run this one again with fibers
+					use_fibers = true;
+					local_fibers().run(threads_per_tile, &TileContext<Kernel, TiledIndex>::body, &context);
+				}
+				return false;
+			};
+			if (tile_count == 0) { return; }
+			use_fibers = run_tile(0);
+			run_on_pool(tile_count - 1, [&](unsigned task)
+			{
+				run_tile(task + 1);
+			});
+		}
+	}
+
+	template <int D0, int D1, typename Kernel>
+	void parallel_for_each(const tiled_extent<D0, D1>& compute_domain, const Kernel& kernel)
+	{
+		details::run_tiles<Kernel, tiled_index<D0, D1>, 2>(compute_domain, index<2>(D0, D1), D0 * D1, kernel);
+	}
+
+	template <int D0, typename Kernel>
+	void parallel_for_each(const tiled_extent<D0>& compute_domain, const Kernel& kernel)
+	{
+		details::run_tiles<Kernel, tiled_index<D0>, 1>(compute_domain, index<1>(D0), D0, kernel);
+	}
+
+	template <int D0, int D1, typename Kernel>
+	void parallel_for_each(const accelerator_view&, const tiled_extent<D0, D1>& compute_domain, const Kernel& kernel)
+	{
+		parallel_for_each(compute_domain, kernel);
+	}
+
+	template <int D0, typename Kernel>
+	void parallel_for_each(const accelerator_view&, const tiled_extent<D0>& compute_domain, const Kernel& kernel)
+	{
+		parallel_for_each(compute_domain, kernel);
+	}
+
+	// untiled kernels - rows of the extent are spread over the workers
+	template <int N, typename Kernel>
+	void parallel_for_each(const extent<N>& compute_domain, const Kernel& kernel)
+	{
+		const unsigned rows = compute_domain[0];
+		const unsigned row_size = rows == 0 ? 0 : compute_domain.size() / rows;
+		details::run_on_pool(rows, [&](unsigned row)
+		{
+			for (unsigned i = 0; i < row_size; ++i)
+			{
+				index<N> idx;
+				for (int d = N - 1, rest = i; d > 0; --d)
+				{
+					idx[d] = rest % compute_domain[d];
+					rest /= compute_domain[d];
+				}
+				idx[0] = row;
+				Kernel copy(kernel);
+				copy(idx);
+			}
+		});
+	}
+
+	template <int N, typename Kernel>
+	void parallel_for_each(const accelerator_view&, const extent<N>& compute_domain, const Kernel& kernel)
+	{
+		parallel_for_each(compute_domain, kernel);
+	}
+
+	// <amp_math.h>
+	namespace fast_math
+	{
+		inline float sqrt(float x) { return std::sqrt(x); }
+		inline float sqrtf(float x) { return std::sqrt(x); }
+		inline float fabs(float x) { return std::fabs(x); }
+	}
+	namespace precise_math
+	{
+		inline float sqrt(float x) { return std::sqrt(x); }
+		inline double sqrt(double x) { return std::sqrt(x); }
+		inline float fabs(float x) { return std::fabs(x); }
+		inline double fabs(double x) { return std::fabs(x); }
+	}
+}
+
+namespace Concurrency = concurrency;
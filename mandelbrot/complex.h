@@ -1,5 +1,10 @@
 #pragma once
+#ifdef _MSC_VER
 #include <amp_math.h>
+#else
+#include "amp_cpu.h" // CPU emulation of C++ AMP for GCC/Clang
+#endif
+#include "EscapeKernel.h" // PERIODICITY_EPSILON and PERIODICITY_MAX_INTERVAL
 
 // using our own structure as Complex function not available in the Concurrency namespace
 struct Complex 
@@ -9,7 +14,7 @@ struct Complex
 };
 
 // c_add
-Complex c_add(Complex c1, Complex c2) restrict(cpu, amp) // restrict keyword - able to execute this function on the GPU and CPU
+inline Complex c_add(Complex c1, Complex c2) restrict(cpu, amp) // restrict keyword - able to execute this function on the GPU and CPU
 {
 	Complex tmp;
 
@@ -24,13 +29,13 @@ Complex c_add(Complex c1, Complex c2) restrict(cpu, amp) // restrict keyword - a
 }
 
 // c_abs
-float c_abs(Complex c) restrict(cpu, amp)
+inline float c_abs(Complex c) restrict(cpu, amp)
 {
 	return concurrency::fast_math::sqrt(c.x*c.x + c.y*c.y);
 }
 
 // c_mul
-Complex c_mul(Complex c1, Complex c2) restrict(cpu, amp)
+inline Complex c_mul(Complex c1, Complex c2) restrict(cpu, amp)
 {
 	Complex tmp;
 	float a = c1.x;
@@ -41,3 +46,36 @@ Complex c_mul(Complex c1, Complex c2) restrict(cpu, amp)
 	tmp.y = b*c + a*d;
 	return tmp;
 }
+
+// Iterate z = z^2 + c from (0, 0) until z moves further than the escape radius
+// away from (0, 0), or we've iterated max_iter times - returns the number of iterations.
+// Points in the main cardioid or the period-2 bulb aren't iterated, and an orbit that comes back to
+// where it was at the last checkpoint (Brent's cycle detection) stops early - neither ever escapes.
+inline unsigned c_escape_time(Complex c, unsigned max_iter, float escape_radius) restrict(cpu, amp)
+{
+	const float x = c.x - 0.25f;
+	const float q = x * x + c.y * c.y;
+	if (q * (q + x) <= 0.25f * c.y * c.y || (c.x + 1.0f) * (c.x + 1.0f) + c.y * c.y <= 0.0625f) { return max_iter; }
+
+	Complex z = { 0, 0 };
+	Complex saved = z;
+	unsigned interval = 1;
+	unsigned checkpoint = 1;
+	unsigned iterations = 0;
+	while (c_abs(z) < escape_radius && iterations < max_iter)
+	{
+		z = c_add(c_mul(z, z), c);
+
+		++iterations;
+		const float dx = z.x - saved.x;
+		const float dy = z.y - saved.y;
+		if (dx * dx + dy * dy < PERIODICITY_EPSILON * PERIODICITY_EPSILON) { return max_iter; }
+		if (iterations == checkpoint)
+		{
+			saved = z;
+			if (interval < PERIODICITY_MAX_INTERVAL) { interval *= 2; }
+			checkpoint = iterations + interval;
+		}
+	}
+	return iterations;
+}
@@ -17,3 +17,14 @@ using std::endl;
 using std::ofstream;
 // Define the alias "the_clock" for the clock type we're going to use.
 typedef std::chrono::steady_clock the_clock;
+
+#ifndef _WIN32
+// Windows only functions and constants used by the project
+#define MB_ICONERROR 0x10
+#define DM_YRESOLUTION 0x2000
+inline int MessageBoxA(void *, const char * text, const char * caption, unsigned)
+{
+	std::cout << caption << ": " << text << std::endl;
+	return 0;
+}
+#endif
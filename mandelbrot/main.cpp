@@ -3,7 +3,7 @@
 #include <freeglut.h>
 #include "dependencies.h"
 #include "mandelbrot.h"
-#include "input.h"
+#include "Input.h"
 #include "Camera.h"
 #include "FreeCamera.h"
 
@@ -197,10 +197,26 @@ void renderScene()
 	glutSwapBuffers();
 }
 
+// Usage: mandelbrot [width height [escape_radius]]
+// width x height is the size of the calculated image (e.g. 16384 16384 for timing runs),
+// without it the image has the size of the window.
 int main(int argc, char *argv[])
 {
-	// Init GLUT and create window
+	// Init GLUT and create window (glutInit removes the arguments it knows)
 	glutInit(&argc, argv);
+	unsigned frame_width = 0;
+	unsigned frame_height = 0;
+	float escape_radius = 2.0f;
+	if (argc >= 3)
+	{
+		frame_width = (unsigned)atoi(argv[1]);
+		frame_height = (unsigned)atoi(argv[2]);
+	}
+	if (argc >= 4)
+	{
+		escape_radius = (float)atof(argv[3]);
+		if (escape_radius <= 0.0f) { escape_radius = 2.0f; }
+	}
 	glutInitDisplayMode(GLUT_DEPTH | GLUT_DOUBLE | GLUT_RGBA);
 	glutInitWindowPosition(WINDOW_INIT_X, DM_YRESOLUTION / 1000);
 	glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
@@ -225,7 +241,7 @@ int main(int argc, char *argv[])
 	glutMouseFunc(processMouseButtons);
 
 	input = new Input();
-	mandelbrot = new Mandelbrot(input);
+	mandelbrot = new Mandelbrot(input, frame_width, frame_height, escape_radius);
 
 	// Enter GLUT event processing cycle
 	glutMainLoop();
@@ -1,7 +1,15 @@
 ﻿#include "mandelbrot.h"
-#include "Complex.h"
-
-Mandelbrot::Mandelbrot(Input * in)
+#include "CpuBackend.h"
+
+Mandelbrot::Mandelbrot(Input * in, unsigned frame_width, unsigned frame_height, float escape_radius) :
+	escape_radius_(escape_radius),
+	frame_width_(frame_width),
+	frame_height_(frame_height),
+	requested_width_(0),
+	requested_height_(0),
+	amp_mandelbrot_texture_(GL_BGR_EXT, GL_UNSIGNED_BYTE),   // <----- had to use GL_BGR_EXT
+	amp_pixel_mandelbrot_texture_(GL_BGRA_EXT, GL_UNSIGNED_BYTE),   // packed texels written by the kernel
+	amp_barrier_mandelbrot_texture_(GL_BGRA_EXT, GL_UNSIGNED_BYTE)
 {
 	//OpenGL settings			
 	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);				// Really Nice Perspective Calculations
@@ -15,18 +23,6 @@ Mandelbrot::Mandelbrot(Input * in)
 
 Mandelbrot::~Mandelbrot()
 {
-	file_amp_mandelbrot_nvidia_.close();
-	file_amp_mandelbrot_msc_basic_render_driver_.close();
-	file_amp_mandelbrot_software_adapter_.close();
-	file_amp_mandelbrot_cpu_accelerator_.close();
-	file_amp_pixel_mandelbrot_nvidia_.close();
-	file_amp_pixel_mandelbrot_msc_basic_render_driver_.close();
-	file_amp_pixel_mandelbrot_software_adapter_.close();
-	file_amp_pixel_mandelbrot_cpu_accelerator_.close();
-	file_amp_barrier_mandelbrot_nvidia_.close();
-	file_amp_barrier_mandelbrot_msc_basic_render_driver_.close();
-	file_amp_barrier_mandelbrot_software_adapter_.close();
-	file_amp_barrier_mandelbrot_cpu_accelerator_.close();
 }
 
 void Mandelbrot::init(Input * in)
@@ -35,563 +31,180 @@ void Mandelbrot::init(Input * in)
 	camera = &freeCamera;
 	scale_.set(1.0f, 1.0f, 0.0f);
 	translate_.set(0.0f, 0.0f, 0.0f);
-	zoom_.set(1.0f, 1.0f, 0.0f);
-	zoom_scale_ = 1.0f;
+	// start with the whole set
+	reset_view();
+	dragging_ = false;
+	drag_x_ = 0;
+	drag_y_ = 0;
+	pan_x_ = 0.0f;
+	pan_y_ = 0.0f;
+	pan_pending_ = false;
+	zoomed_ = false;
+	focus_first_ = true;
+	focus_cursor_ = false;
 	// default mandelbrot calculation function
 	calc_mandelbrot_ = AMP_MANDELBROT;
 	// maximum number of iterations for all the Mandelbrot functions
 	max_iterations_ = 0;
 	// condition flag to calculate Mandlebrot only when the funciton is called
 	calculate_ = false;
-	// vector to hold all accelerators
-	accls_ = accelerator::get_all();
-	// varaibles to hold number of the current accelerator
-	current_accelerator_ = 0;
-	// 
-	pixel_amp_mandelbrot_.reserve(DATA_SIZE * 3);
-	pixel_amp_barrier_mandelbrot_ = std::vector<int>(DATA_SIZE * 3);
+	// create all backends (C++ AMP accelerators, CPU engine, ...) and use the first one able to run amp_mandelbrot
+	BackendRegistry::instance().create_backends();
+	backend_ = BackendRegistry::instance().find(calc_mandelbrot_);
+	// colour changes only recolour the escape counts of amp_mandelbrot and cpu_mandelbrot
+	recolour_ = false;
+	palette_offset_ = 0;
 	// colours
 	r_ = 250;
 	g_ = 68;
 	b_ = 32;
 	// timing number of times variables
-	i_ = 0;
 	max_timings_ = 100;
 	timing_ = false;
-	// files to write timings to
-	file_amp_mandelbrot_nvidia_.open("amp_mandelbrot_NVIDIA_.csv");
-	file_amp_mandelbrot_msc_basic_render_driver_.open("amp_mandelbrot_MICROSOFT_basic_render_driver_.csv");
-	file_amp_mandelbrot_software_adapter_.open("amp_mandelbrot_software_adapter_.csv");
-	file_amp_mandelbrot_cpu_accelerator_.open("amp_mandelbrot_cpu_accelerator_.csv");
-	file_amp_pixel_mandelbrot_nvidia_.open("amp_pixel_mandelbrot_NVIDIA_.csv");
-	file_amp_pixel_mandelbrot_msc_basic_render_driver_.open("amp_pixel_mandelbrot_MICROSOFT_basic_render_driver_.csv");
-	file_amp_pixel_mandelbrot_software_adapter_.open("amp_pixel_mandelbrot_software_adapter_.csv");
-	file_amp_pixel_mandelbrot_cpu_accelerator_.open("amp_pixel_mandelbrot_cpu_accelerator_.csv");
-	file_amp_barrier_mandelbrot_nvidia_.open("amp_barrier_mandelbrot_NVIDIA_.csv");
-	file_amp_barrier_mandelbrot_msc_basic_render_driver_.open("amp_barrier_mandelbrot_MICROSOFT_basic_render_driver_.csv");
-	file_amp_barrier_mandelbrot_software_adapter_.open("amp_barrier_mandelbrot_software_adapter_.csv");
-	file_amp_barrier_mandelbrot_cpu_accelerator_.open("amp_barrier_mandelbrot_cpu_accelerator_.csv");
 }
 
-// convert wstring to string
-std::string Mandelbrot::ws2s(const std::wstring& wstr)
+// select a backend from the BackendRegistry
+void Mandelbrot::use_backend(Backend * backend)
 {
-	using convert_typeX = std::codecvt_utf8<wchar_t>;
-	std::wstring_convert<convert_typeX, wchar_t> converterX;
-
-	return converterX.to_bytes(wstr);
-}
-
-// Render the Mandelbrot set into the image array.
-// The parameters specify the region on the complex plane to plot.
-void Mandelbrot::cpu_mandelbrot(float left, float right, float top, float bottom)
-{
-	for (int y = 0; y < HEIGHT; ++y)
+	backend_ = backend;
+	BackendRegistry& backends = BackendRegistry::instance();
+	cout << "Using acc " << backends.index_of(backend_) + 1 << " = " << backend_->description() << endl;
+	// the backend can't run the current method - switch to the first method it supports
+	if (!backend_->supports(calc_mandelbrot_))
 	{
-		for (int x = 0; x < WIDTH; ++x)
+		for (int method = AMP_MANDELBROT; method <= CPU_MANDELBROT; ++method)
 		{
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
-
-			complex<double> c(left + (x * (right - left) / WIDTH),
-				top + (y * (bottom - top) / HEIGHT));
-
-			// Start off z at (0, 0).
-			complex<double> z(0.0, 0.0);
-
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			int iterations = 0;
-			while (abs(z) < 2.0 && iterations < max_iterations_)
-			{
-				z = (z * z) + c;
-
-				++iterations;
-			}
-
-			uint8_t r, g, b;
-			if (iterations == max_iterations_)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				//image[x*WIDTH + y] = 0x000000; // black
-				r = 250;
-				g = 32;
-				b = 32;
-			}
-			else
+			if (backend_->supports((CALC_MANDELBROT)method))
 			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				//image[x*WIDTH + y] = 0xFFFFFF; // white
-				r = iterations * (iterations - 3) * 250;
-				g = iterations * (iterations - 2) * 250;
-				b = iterations * (iterations - 1) * 32;
+				calc_mandelbrot_ = (CALC_MANDELBROT)method;
+				cout << "\nDisplaying " << method_name(calc_mandelbrot_) << " set\n" << endl;
+				break;
 			}
-			//image[x*WIDTH + y] = (r << 16) | (g << 8) | (b);
-			//// calculate pixel image
-			//pixel.clear();
-			//pixel.push_back(image[x*HEIGHT + y] & 0xFF); // blue channel
-			//pixel.push_back((image[x*HEIGHT + y] >> 8) & 0xFF); // green channel
-			//pixel.push_back((image[x*HEIGHT + y] >> 16) & 0xFF); // red channel
 		}
 	}
-	i_++;
-	calculate_ = false;
 }
 
-void Mandelbrot::amp_mandelbrot(float left, float right, float top, float bottom)
+// select a calculation method (switches to the first backend able to run it if the current one can't)
+void Mandelbrot::use_method(CALC_MANDELBROT method)
 {
-	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
-	/// marshaling the this pointer which is not allowed by one of the restrictions. 
-	/// Hence the member variables are copied to local variables and then used inside the kernel.
-	// extent - the extent class specifies the lenght of the data 
-	// in each dimension of the array or array_view object
-	// you can create an extent object and use it to create an array or array_view object
-	// you can also specify	the extent using explicit parameters
-	// in the array or array_view constructor
-	// in this case an extent object is used to 
-	// create a 2D array_view object 
-	// with rows and columns defined 
-	// by WIDTH and HEIGHT of the Mandelbrot set
-
-	// call once to put into file name of the function, accelerator and number of tiles
-	std::call_once(accls_amp_mandelbrot_flag, [=]() {
-		switch (current_accelerator_) {
-		case NVIDIA: {
-			file_amp_mandelbrot_nvidia_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case MICROSOFT_BASIC_RENDER_DRIVER: {
-			file_amp_mandelbrot_msc_basic_render_driver_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case SOFTWARE_ADAPTER: {
-			file_amp_mandelbrot_software_adapter_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case CPU_ACCELERATOR: {
-			file_amp_mandelbrot_cpu_accelerator_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		}
-	});
-
-	// accelerator to be used with parallel for each
-	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
-	accelerator_view av = accls_[current_accelerator_].default_view;
-
-	// array view - wraper for image array to calculate mandelbrot
-	image_amp_mandelbrot_.empty();
-	extent<2> e(WIDTH, HEIGHT);
-	array_view<uint32_t, 2> image_array_view(e, image_amp_mandelbrot_);
-	image_array_view.discard_data(); // discarding image_array_view data and empting image array speeds up calculations
-
-	// TODO delete this - array_view<uint32_t, 1> v = pixel_int_array.reinterpret_as<uint32_t>();
-	// variables to pass to parallel_for_each lambda function
-	unsigned max_iter = max_iterations_;
-	unsigned r = r_;
-	unsigned g = g_;
-	unsigned b = b_;
-	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
-	// a tile - a group of threads within the thread block
-	// tiling up to 3D
-	try
-	{
-		// kernel - code that's embeded in parallel_for_each function   
-		parallel_for_each(
-			av,                                                   // what accelerator to use
-			image_array_view.extent.tile<TILE_SIZE, TILE_SIZE>(), // times kernel is to tun - compute domain     
-			[=]                                                   // pass data to computation tho' capture clause by value [=]
-			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx)             // index to access elem. of array_view
-			mutable                                               // mutable allows copies to be modified, but not originals
-			restrict(amp)                                         // subset of the C++ language that C++ AMP can accelerate is used
-		{                                                                     
-			// index - represents a unique point in N-dimensional space. 
-			// The index Class specifies a location in the array or array_view object 
-			// (by encapsulating the offset from the origin in each dimension into one object)
-			// the first parameter in the index constructor gives row number,
-			// and the second parameter gives column (within row) for 2D
-			index<2> idx = t_idx.global; // changes for tiled index - (latency hiding?)
-
-			// Start off z at (0, 0).
-
-			Complex z = { 0, 0 };
-
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
-
-			Complex c =
-			{
-				// idx[0] represents row
-				left + (idx[0] * (right - left) / WIDTH),
-				// idx[1] represents column
-				top + (idx[1] * (bottom - top) / HEIGHT)
-			};
-
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			unsigned iterations = 0;
-			while (c_abs(z) < 2.0 && iterations < max_iter)
-			{
-				z = c_add(c_mul(z, z), c);
-
-				++iterations;
-			}
-			// set colours
-			if (iterations == max_iter)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				// r, g, b values are being modified outside the lambda
-				// and passed directly to the image_array_view
-			}
-			else
-			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				r = iterations * iterations * r;
-				g = iterations * iterations * g;
-				b = iterations * iterations * b;
-			}
-			//unsigned int atomic_fetch_or(r << 16);
-			image_array_view[idx] = (r << 16) | (g << 8) | (b);
-		});
-		// Implicit Synchronisation - No potential interactions amongst threads therefore none is needed
-		image_array_view.synchronize(); // copy data back to CPU
-	}
-	catch (const Concurrency::runtime_exception& ex)
+	calc_mandelbrot_ = method;
+	cout << "\nDisplaying " << method_name(calc_mandelbrot_) << " set\n" << endl;
+	if (backend_ == nullptr || !backend_->supports(calc_mandelbrot_))
 	{
-		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+		Backend * backend = BackendRegistry::instance().find(calc_mandelbrot_);
+		if (backend != nullptr) { use_backend(backend); }
 	}
-	// calculate pixel image
-	auto pixel_image = std::async(std::launch::async, [&]()
-	{
-		pixel_amp_mandelbrot_.clear();
-		// generating pixel vector with mandelbrot image 
-		for (int y = 0; y < HEIGHT; ++y)
-		{
-			for (int x = 0; x < WIDTH; ++x)
-			{
-				pixel_amp_mandelbrot_.push_back((image_amp_mandelbrot_[x * HEIGHT + y]) & 0xFF); // blue channel
-				pixel_amp_mandelbrot_.push_back((image_amp_mandelbrot_[x * HEIGHT + y] >> 8) & 0xFF); // green channel
-				pixel_amp_mandelbrot_.push_back((image_amp_mandelbrot_[x * HEIGHT + y] >> 16) & 0xFF); // red channel
-			}
-		}
-	});
-	// set calculations flag to false
-	i_++;
-	calculate_ = false; 
 }
 
-// No potential interactions amongst threads therefore none is needed
-void Mandelbrot::amp_pixel_mandelbrot(float left, float right, float top, float bottom)
+// size of the next frame - the size set on the command line or the size of the window
+void Mandelbrot::frame_size(unsigned& width, unsigned& height) const
 {
-	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
-	/// marshaling the this pointer which is not allowed by one of the restrictions. 
-	/// Hence the member variables are copied to local variables and then used inside the kernel.
-	// extent - the extent class specifies the lenght of the data 
-	// in each dimension of the array or array_view object
-	// you can create an extent object and use it to create an array or array_view object
-	// you can also specify	the extent using explicit parameters
-	// in the array or array_view constructor
-	// in this case an extent object is used to 
-	// create a 2D array_view object 
-	// with rows and columns defined 
-	// by WIDTH and HEIGHT of the Mandelbrot set
-
-	std::call_once(accls_pixel_mandelbrot_flag, [=]() {
-		switch (current_accelerator_) {
-		case NVIDIA: {
-			file_amp_pixel_mandelbrot_nvidia_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case MICROSOFT_BASIC_RENDER_DRIVER: {
-			file_amp_pixel_mandelbrot_msc_basic_render_driver_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case SOFTWARE_ADAPTER: {
-			file_amp_pixel_mandelbrot_software_adapter_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case CPU_ACCELERATOR: {
-			file_amp_pixel_mandelbrot_cpu_accelerator_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		}
-	});
-
-	// accelerator to be used with parallel for each
-	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
-	accelerator_view av = accls_[current_accelerator_].default_view;
-
-	image_amp_pixel_mandlebrot_.empty();
-	// array view - wraper for image array to calculate mandelbrot
-	extent<2> image_array_view_e(WIDTH, HEIGHT);
-	array_view<uint32_t, 2> image_array_view(image_array_view_e, image_amp_pixel_mandlebrot_);
-	image_array_view.discard_data();
-
-	pixel_amp_pixel_mandlebrot_.empty();
-	// array view - wraper for pixel array to hold mandelbrot pixel values
-	extent<1> pixel_amp_pixel_mandlebrot_e(HEIGHT * WIDTH * 3);
-	array_view<int, 1> pixel_amp_pixel_mandlebrot_array_view(pixel_amp_pixel_mandlebrot_e, pixel_amp_pixel_mandlebrot_);
-	pixel_amp_pixel_mandlebrot_array_view.discard_data();
-
-	unsigned max_iter = max_iterations_;
-	unsigned r = r_;
-	unsigned g = g_;
-	unsigned b = b_;
-	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
-	// a tile - a group of threads within the thread block
-	// tiling up to 3D
-	try
-	{
-		// kernel - code that's embeded in parallel_for_each function
-		parallel_for_each(
-			av,                                                      // what accelerator to use
-			image_array_view.extent.tile<TILE_SIZE, TILE_SIZE>(),	 // times kernel is to tun - compute domain     
-			[=]														 // pass data to computation tho' capture clause by value [=]
-			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx) 				 // index to access elem. of array_view
-			mutable 												 // mutable allows copies to be modified, but not originals
-			restrict(amp) 											 // subset of the C++ language that C++ AMP can accelerate is used
-		{
-			// index - represents a unique point in N-dimensional space. 
-			// The index Class specifies a location in the array or array_view object 
-			// (by encapsulating the offset from the origin in each dimension into one object)
-			// the first parameter in the index constructor gives row number,
-			// and the second parameter gives column (within row) for 2D
-			index<2> idx = t_idx.global; // changes for tiled index - (latency hiding?)
-
-			// tile_static int t[WIDTH][HEIGHT];
-			// Start off z at (0, 0).
-			Complex z = { 0, 0 };
-
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
-			Complex c =
-			{
-				// idx[0] represents rows
-				left + (idx[0] * (right - left) / WIDTH),
-				// idx[1] represents columns
-				top + (idx[1] * (bottom - top) / HEIGHT)
-			};
-
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			unsigned iterations = 0;
-			while (c_abs(z) < 2.0 && iterations < max_iter)
-			{
-				z = c_add(c_mul(z, z), c);
-
-				++iterations;
-			}
-			// set colours
-			if (iterations == max_iter)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				r = iterations * iterations * iterations * r;
-				g = iterations * iterations * iterations * g;
-				b = iterations * iterations * iterations * b;
-			}
-			else
-			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				r = iterations * iterations * iterations * iterations * iterations* r;
-				g = iterations * iterations * iterations * iterations * iterations* g;
-				b = iterations * iterations * iterations * iterations * iterations* b;
-			}
-			int index = (idx[0] * WIDTH + idx[1]) * 3;
-			pixel_amp_pixel_mandlebrot_array_view[index] = b;
-			pixel_amp_pixel_mandlebrot_array_view[index + 1] = (g << 8);
-			pixel_amp_pixel_mandlebrot_array_view[index + 2] = (r << 16);
-
-			index = (idx[0] + idx[1] * HEIGHT) * 3;
-			pixel_amp_pixel_mandlebrot_array_view[index] = b;
-			pixel_amp_pixel_mandlebrot_array_view[index + 1] = (g << 8);
-			pixel_amp_pixel_mandlebrot_array_view[index + 2] = (r << 16);
-		});
-		// Implicit Synchronisation - No potential interactions amongst threads therefore none is needed
-		image_array_view.synchronize(); // copy back data to CPU
-	}
-	catch (const Concurrency::runtime_exception& ex)
+	width = frame_width_;
+	height = frame_height_;
+	if (width == 0 || height == 0)
 	{
-		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
+		width = (unsigned)glutGet(GLUT_WINDOW_WIDTH);
+		height = (unsigned)glutGet(GLUT_WINDOW_HEIGHT);
 	}
-	// set calculations flag to false
-	i_++;
-	calculate_ = false;
+	if (width == 0) { width = 1; }
+	if (height == 0) { height = 1; }
 }
 
-// Will not work for TILE_SIZE == 32, will work for TILE_SIZE < 32
-// The smaller number of TILE_SIZE the more detailed the image is
-void Mandelbrot::amp_barrier_mandelbrot(float left, float right, float top, float bottom)
+// show the whole set (-2 to 1 on the real axis, -1.125 to 1.125 on the imaginary one)
+void Mandelbrot::reset_view()
 {
-	/// Also observe that the parallel_for_each is not using member variables directly because that would involve
-	/// marshaling the this pointer which is not allowed by one of the restrictions. 
-	/// Hence the member variables are copied to local variables and then used inside the kernel.
-	// extent - the extent class specifies the lenght of the data 
-	// in each dimension of the array or array_view object
-	// you can create an extent object and use it to create an array or array_view object
-	// you can also specify	the extent using explicit parameters
-	// in the array or array_view constructor
-	// in this case an extent object is used to 
-	// create a 2D array_view object 
-	// with rows and columns defined 
-	// by WIDTH and HEIGHT of the Mandelbrot set
-
-	// call once to put into file name of the function, accelerator and number of tiles
-	std::call_once(accls_barrier_mandelbrot_flag, [=]() {
-		switch (current_accelerator_) {
-		case NVIDIA: {
-				file_amp_barrier_mandelbrot_nvidia_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-				file_amp_barrier_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case MICROSOFT_BASIC_RENDER_DRIVER: {
-				file_amp_barrier_mandelbrot_msc_basic_render_driver_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-				file_amp_barrier_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case SOFTWARE_ADAPTER: {
-				file_amp_barrier_mandelbrot_software_adapter_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-				file_amp_barrier_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		case CPU_ACCELERATOR: {
-				file_amp_barrier_mandelbrot_cpu_accelerator_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-				file_amp_barrier_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-		} break;
-		}
-	});
-
-	// accelerator to be used with parallel for each
-	//accelerator_view av1 = accelerator(accelerator::default_accelerator).default_view;
-	accelerator_view av = accls_[current_accelerator_].default_view;
-
-	image_amp_barrier_mandelbrot_.empty();
-	// array view - wraper for image array to calculate mandelbrot
-	extent<2> image_array_view_e(WIDTH, HEIGHT);
-	array_view<uint32_t, 2> image_array_view(image_array_view_e, image_amp_barrier_mandelbrot_);
-	image_array_view.discard_data();
-
-	// array view - wraper for pixel array to hold mandelbrot pixel values
-	pixel_amp_barrier_mandelbrot_.clear();
-	extent<1> pixel_amp_barrier_mandelbrot_e(HEIGHT * WIDTH * 3);
-	array<int, 1> pixel_amp_barrier_mandelbrot_array(pixel_amp_barrier_mandelbrot_e, pixel_amp_barrier_mandelbrot_.begin(), pixel_amp_barrier_mandelbrot_.end());
-
-
-	unsigned max_iter = max_iterations_;
-	unsigned r = r_;
-	unsigned g = g_;
-	unsigned b = b_;
-	// a tile - a bunch/group/block of threads (a thread block/Direct Compute - a working group/OpenCL)
-	// a tile - a group of threads within the thread block
-	// tiling up to 3D
-	try
-	{
-		// kernel - code that's embeded in parallel_for_each function
-		parallel_for_each(
-			av,                                                   // what accelerator to use
-			image_array_view.extent.tile<TILE_SIZE, TILE_SIZE>(), // times kernel is to tun - compute domain     
-			[=, &pixel_amp_barrier_mandelbrot_array]			  // pass data to computation tho' capture clause by value [=] and pass pixel_amp_barrier_mandelbrot_array by reference [&]
-			(tiled_index<TILE_SIZE, TILE_SIZE> t_idx) 			  // index to access elem. of array_view
-			mutable 											  // mutable allows copies to be modified, but not originals
-			restrict(amp)										  // subset of the C++ language that C++ AMP can accelerate is used
-		{
-			// index - represents a unique point in N-dimensional space. 
-			// The index Class specifies a location in the array or array_view object 
-			// (by encapsulating the offset from the origin in each dimension into one object)
-			// the first parameter in the index constructor gives row number,
-			// and the second parameter gives column (within row) for 2D
-			index<2> idx = t_idx; // global index for image_array_view to hold row and column number
-
-			// Start off z at (0, 0).
-			Complex z = { 0, 0 };
-
-			// Work out the point in the complex plane that
-			// corresponds to this pixel in the output image.
+	centre_x_ = -0.5;
+	centre_y_ = 0.0;
+	view_width_ = 3.0;
+	view_height_ = 2.25;
+}
 
-			Complex c =
-			{
-				// idx[0] represents row
-				left + (idx[0] * (right - left) / WIDTH),
-				// idx[1] represents column
-				top + (idx[1] * (bottom - top) / HEIGHT)
-			};
+// size of a frame pixel on the complex plane
+// the view is widened along one axis so the set isn't stretched by the aspect ratio of the frame
+double Mandelbrot::pixel_step(unsigned width, unsigned height) const
+{
+	const double step_x = view_width_ / width;
+	const double step_y = view_height_ / height;
+	return step_x > step_y ? step_x : step_y;
+}
 
-			// Iterate z = z^2 + c until z moves more than 2 units
-			// away from (0, 0), or we've iterated too many times.
-			unsigned iterations = 0;
-			while (c_abs(z) < 2.0 && iterations < max_iter)
-			{
-				z = c_add(c_mul(z, z), c);
+// the region is a whole number of pixels from the centre, so a pan moves it by whole pixels
+void Mandelbrot::view_region(unsigned width, unsigned height, double& left, double& right, double& top, double& bottom) const
+{
+	const double step = pixel_step(width, height);
+	left = centre_x_ - step * (width / 2.0);
+	right = centre_x_ + step * (width / 2.0);
+	top = centre_y_ + step * (height / 2.0);
+	bottom = centre_y_ - step * (height / 2.0);
+}
 
-				++iterations;
-			}
-			// set colours
-			if (iterations == max_iter)
-			{
-				// z didn't escape from the circle.
-				// This point is in the Mandelbrot set.
-				// r, g, b values are being modified outside the lambda
-				// and passed directly to the image_array_view
-			}
-			else
-			{
-				// z escaped within less than MAX_ITERATIONS
-				// iterations. This point isn't in the set.
-				r = iterations * iterations * r;
-				g = iterations * iterations * g;
-				b = iterations * iterations * b;
-			}
-			//unsigned int atomic_fetch_or(r << 16);
-			image_array_view[idx] = (r << 16) | (g << 8) | (b);
-			// Copy the values of the tile into a tile-sized array. 
-			// create a TILE_SIZE x TILE_SIZE array to hold the values in this tile
-			tile_static int tileValues[TILE_SIZE][TILE_SIZE];
-			// copy the values for the tile into the TILE_SIZE x TILE_SIZE array
-			tileValues[t_idx.local[1]][t_idx.local[0]] = image_array_view[t_idx];
-			// when all the threads have exectuted and the TILE_SIZE x TILE_SIZE array is complete, calculate pixel array
-			t_idx.barrier.wait_with_tile_static_memory_fence();
+// zoom the view keeping the point under the mouse where it is
+void Mandelbrot::zoom_at(int mouse_x, int mouse_y, double factor)
+{
+	unsigned width, height;
+	frame_size(width, height);
+	const double step = pixel_step(width, height);
+	// point of the complex plane under the mouse (the frame fills the window)
+	const double x = centre_x_ + step * (double(mouse_x) * width / glutGet(GLUT_WINDOW_WIDTH) - width / 2.0);
+	const double y = centre_y_ - step * (double(mouse_y) * height / glutGet(GLUT_WINDOW_HEIGHT) - height / 2.0);
+	centre_x_ = x + (centre_x_ - x) * factor;
+	centre_y_ = y + (centre_y_ - y) * factor;
+	view_width_ *= factor;
+	view_height_ *= factor;
+	zoomed_ = true;
+	calculate_ = true;
+}
 
-			int index = (idx[0] * HEIGHT + idx[1]) * 3;
-			for (int row = 0; row < TILE_SIZE; row++) {
-				for (int column = 0; column < TILE_SIZE; column++) {
-					pixel_amp_barrier_mandelbrot_array[index] = tileValues[row][column];
-					pixel_amp_barrier_mandelbrot_array[index + 1] = (tileValues[row][column] << 8);
-					pixel_amp_barrier_mandelbrot_array[index + 2] = (tileValues[row][column] << 16);
-				}
-			}
-		});
-		try 
-		{
-			try 
-			{
-				// because conccurency::array is being used data must be explicitly copied back to the vector
-				// after lambda is finished
-				pixel_amp_barrier_mandelbrot_ = pixel_amp_barrier_mandelbrot_array;
-			}
-			catch (std::bad_alloc& x) 
-			{
-				cout << x.what() << endl;
-			}
-		}
-		catch (std::bad_array_new_length& e) 
-		{
-			cout << e.what() << std::endl;
-		}
-	}
-	catch (const accelerator_view_removed & ex)
-	{
-		cout << ex.what() << endl;
-		cout << ex.get_view_removed_reason() << endl;
-	}
-	catch (const Concurrency::runtime_exception& ex)
-	{
-		MessageBoxA(NULL, ex.what(), "Error", MB_ICONERROR);
-	}
-	// set calculations flag to false
-	i_++;
+// Ask the compute thread to calculate the Mandelbrot set (or only recolour it).
+// A request that wasn't started yet is replaced, the finished frame is picked up by render().
+void Mandelbrot::calculate(bool recolour)
+{
+	unsigned width, height;
+	frame_size(width, height);
+	requested_width_ = width;
+	requested_height_ = height;
+	double left, right, top, bottom;
+	view_region(width, height, left, right, top, bottom);
+	// pixel the user looks at (the frame fills the window)
+	unsigned focus_x = width / 2;
+	unsigned focus_y = height / 2;
+	if (focus_cursor_)
+	{
+		const double x = double(input->getMouseX()) * width / glutGet(GLUT_WINDOW_WIDTH);
+		const double y = double(input->getMouseY()) * height / glutGet(GLUT_WINDOW_HEIGHT);
+		focus_x = x <= 0.0 ? 0 : x >= width ? width - 1 : unsigned(x);
+		focus_y = y <= 0.0 ? 0 : y >= height ? height - 1 : unsigned(y);
+	}
+
+	RenderJob job;
+	FrameRequest& request = job.request;
+	request.method = calc_mandelbrot_;
+	request.width = width;
+	request.height = height;
+	request.left = left;
+	request.right = right;
+	request.top = top;
+	request.bottom = bottom;
+	request.max_iter = (unsigned)max_iterations_;
+	request.escape_radius = escape_radius_;
+	request.r = r_;
+	request.g = g_;
+	request.b = b_;
+	request.reuse_previous = true;
+	request.focus_x = focus_x;
+	request.focus_y = focus_y;
+	request.focus_first = focus_first_;
+	// the cancel token is set by the FrameRenderer when the job is submitted
+	job.backend = backend_;
+	job.recolour = recolour && !timing_;
+	job.palette_offset = palette_offset_;
+	job.timings = timing_ ? max_timings_ : 0;
+	job.progressive = zoomed_;
+	renderer_.submit(job);
 	calculate_ = false;
+	zoomed_ = false;
+	recolour_ = false;
+	timing_ = false;
 }
 
 void Mandelbrot::update(float dt)
@@ -600,47 +213,35 @@ void Mandelbrot::update(float dt)
 	// list all accelerators only once when the programm starts
 	std::call_once(flag_, [=]()
 	{
-		//get all accelerators available to us and store in a vector so we can extract details
-		std::vector<accelerator> accls = accelerator::get_all();
-		if (accls.empty())
+		// backends register themselves with the BackendRegistry
+		BackendRegistry& backends = BackendRegistry::instance();
+		if (backends.size() == 0)
 		{
-			cout << "No accelerators found that are compatible with C++ AMP" << std::endl;
+			cout << "No backends found to calculate the Mandelbrot set" << std::endl;
 		}
 		else
 		{
-			cout << "Accelerators found that are compatible with C++ AMP" << std::endl;
-			// iterates over all accelerators and print characteristics
-			for (unsigned i = 0; i<accls.size(); i++)
+			cout << "Backends found to calculate the Mandelbrot set" << std::endl;
+			// iterates over all backends and print characteristics
+			for (unsigned i = 0; i < backends.size(); i++)
 			{
-				std::wcout << " acc " << i + 1 << " = " << accls[i].description << endl;
-				if (accls[i] == accelerator(accelerator::direct3d_ref))
-					std::cout << " WARNING!! Running on very slow emulator! Only use this accelerator for debugging." << std::endl;
-
-				const std::wstring bs[2] = { L"false", L"true" };
-				std::wcout << ": " << accls[i].description << " "
-					<< endl << "       device_path                       = " << accls[i].device_path
-					<< endl << "       dedicated_memory                  = " << std::setprecision(4) << float(accls[i].dedicated_memory) / (1024.0f * 1024.0f) << " Mb"
-					<< endl << "       has_display                       = " << bs[accls[i].has_display]
-					<< endl << "       is_debug                          = " << bs[accls[i].is_debug]
-					<< endl << "       is_emulated                       = " << bs[accls[i].is_emulated]
-					<< endl << "       supports_double_precision         = " << bs[accls[i].supports_double_precision]
-					<< endl << "       supports_limited_double_precision = " << bs[accls[i].supports_limited_double_precision]
-					<< endl << endl;
+				cout << " acc " << i + 1 << " = " << backends[i].description() << endl;
+				backends[i].print_details(cout);
 			}
 		}
 	});
 
-	const float scale_per = 0.1f * zoom_scale_;
-	// mouse wheel up
+	// mouse wheel down - zoom out around the mouse
+	// the last frame is reprojected onto the new view straight away by render()
 	if (input->isScrollDownMouseWheel())
 	{
-		scale_.subtract(zoom_, zoom_scale_);
+		zoom_at(input->getMouseX(), input->getMouseY(), 1.25);
 		input->setScrollDownMouseWheel(false);
 	}
-	// mouse wheel down
+	// mouse wheel up - zoom in around the mouse
 	if (input->isScrollUpMouseWheel())
 	{
-		scale_.add(zoom_, zoom_scale_);
+		zoom_at(input->getMouseX(), input->getMouseY(), 0.8);
 		input->setScrollUpMouseWheel(false);
 	}
 	// increase: number of maximum iterations; red, green, blue colour values; and recalculate Mandelbrot
@@ -679,7 +280,7 @@ void Mandelbrot::update(float dt)
 		if (r_ == 255) { r_ = 0; }
 		if (g_ == 255) { g_ = 0; }
 		if (b_ == 255) { b_ = 0; }
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// decrease: number of maximum iterations; red, green, blue colour values; and recalculate Mandelbrot
 	if (input->isKeyDown('p') ||
@@ -691,7 +292,7 @@ void Mandelbrot::update(float dt)
 		if (r_ == 0) { r_ = 255; }
 		if (g_ == 0) { g_ = 255; }
 		if (b_ == 0) { b_ = 255; }
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// increase number of maximum iterations
 	if (input->isKeyDown('z') ||
@@ -699,6 +300,7 @@ void Mandelbrot::update(float dt)
 	{
 		max_iterations_ += 1;
 		cout << max_iterations_ << endl;
+		calculate_ = true;
 	}
 	// increase number of maximum iterations (can't go lower than 0)
 	if (input->isKeyDown('x') ||
@@ -706,27 +308,28 @@ void Mandelbrot::update(float dt)
 	{
 		if (max_iterations_ > 0) { max_iterations_ -= 1; }
 		cout << max_iterations_ << endl;
+		calculate_ = true;
 	}
 	// left arrow increase red colour value
 	if (input->isSpecialKeyDown(GLUT_KEY_LEFT))
 	{
 		if (r_ < 255) { ++r_; }
 		cout << "red: " << r_ << endl;
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// right arrow increase green colour value
 	if (input->isSpecialKeyDown(GLUT_KEY_RIGHT))
 	{
 		if (g_ < 255) { ++g_; }
 		cout << "green: " << g_ << endl;
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// up arrow increase blue colour value
 	if (input->isSpecialKeyDown(GLUT_KEY_UP))
 	{
 		if (b_ < 255) { ++b_; }
 		cout << "blue: " << b_ << endl;
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// down arrow and 'r' key to decrease red colour value
 	if ((input->isKeyDown('r') && input->isSpecialKeyDown(GLUT_KEY_DOWN)) ||
@@ -734,7 +337,7 @@ void Mandelbrot::update(float dt)
 	{
 		if (r_ > 0) { --r_; }
 		cout << "red: " << r_ << endl;
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// down arrow and 'g' key to decrease green colour value
 	if ((input->isKeyDown('g') && input->isSpecialKeyDown(GLUT_KEY_DOWN)) ||
@@ -742,7 +345,7 @@ void Mandelbrot::update(float dt)
 	{
 		if (g_ > 0) { --g_; }
 		cout << "green: " << g_ << endl;
-		calculate_ = true;
+		recolour_ = true;
 	}
 	// down arrow and 'b' key to decrease blue colours value
 	if ((input->isKeyDown('b') && input->isSpecialKeyDown(GLUT_KEY_DOWN)) ||
@@ -750,7 +353,14 @@ void Mandelbrot::update(float dt)
 	{
 		if (b_ > 0) { --b_; }
 		cout << "blue: " << b_ << endl;
-		calculate_ = true;
+		recolour_ = true;
+	}
+	// cycle the colours of the points outside the set
+	if (input->isKeyDown('k') ||
+		input->isKeyDown('K'))
+	{
+		++palette_offset_;
+		recolour_ = true;
 	}
 	// display current values of red, green, blue colours and maximum iterations
 	if (input->isKeyDown('l') ||
@@ -761,6 +371,9 @@ void Mandelbrot::update(float dt)
 		<< endl << "green: " << g_ 
 		<< endl << "blue: " << b_ 
 		<< endl << "iterations: " << max_iterations_ 
+		<< endl << "escape radius: " << escape_radius_
+		<< endl << "frame: " << requested_width_ << "x" << requested_height_
+		<< endl << "centre: " << centre_x_ << " " << centre_y_ << "i"
 		<< endl << endl;
 		input->SetKeyUp('l'); 
 		input->SetKeyUp('L');
@@ -783,256 +396,296 @@ void Mandelbrot::update(float dt)
 		input->SetKeyUp('v');
 		input->SetKeyUp('V');
 	}
-	// use NVIDIA accelerator with current Mandelbrot
-	if (input->isKeyDown('1'))
+	// show the whole set again
+	if (input->isKeyDown('h') ||
+		input->isKeyDown('H'))
 	{
-		// set current accelerator to NVIDIA
-		current_accelerator_ = 0;
-		// depending on the current Mandelbrot method being used put timing results into separate files
-		switch (calc_mandelbrot_)
-		{
-		case AMP_MANDELBROT :
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_mandelbrot_nvidia_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-
-			break;
-		case AMP_PIXEL_MANDELBROT :
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_pixel_mandelbrot_nvidia_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_BARRIER_MANDELBROT :
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_barrier_mandelbrot_nvidia_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_barrier_mandelbrot_nvidia_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		}
-		input->SetKeyUp('1');
+		reset_view();
+		calculate_ = true;
+		input->SetKeyUp('h');
+		input->SetKeyUp('H');
 	}
-	// use Microsoft basic render driver accelerator with current Mandelbrot
-	if (input->isKeyDown('2'))
+	// drag with the left mouse button to pan the view
+	if (input->isLeftMouseButtonPressed())
 	{
-		// set current accelerator to Microsoft basic render driver
-		current_accelerator_ = 1;
-		// depending on the current Mandelbrot method being used put timing results into separate files
-		switch (calc_mandelbrot_)
+		const int x = input->getMouseX();
+		const int y = input->getMouseY();
+		if (dragging_)
 		{
-		case AMP_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_mandelbrot_msc_basic_render_driver_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_PIXEL_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_pixel_mandelbrot_msc_basic_render_driver_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-
-			break;
-		case AMP_BARRIER_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_barrier_mandelbrot_msc_basic_render_driver_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_barrier_mandelbrot_msc_basic_render_driver_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
+			// the image follows the mouse, so the view moves the other way (in frame pixels)
+			unsigned width, height;
+			frame_size(width, height);
+			pan_x_ += float(drag_x_ - x) * width / float(glutGet(GLUT_WINDOW_WIDTH));
+			pan_y_ += float(drag_y_ - y) * height / float(glutGet(GLUT_WINDOW_HEIGHT));
 		}
-		input->SetKeyUp('2');
+		dragging_ = true;
+		drag_x_ = x;
+		drag_y_ = y;
+	}
+	else
+	{
+		dragging_ = false;
+	}
+	// Pan by whole frame pixels, so the CPU engine can shift the escape counts of the last frame
+	// and only calculate the rows and columns that came into view.
+	const int pan_x = (int)pan_x_;
+	const int pan_y = (int)pan_y_;
+	if (pan_x != 0 || pan_y != 0)
+	{
+		unsigned width, height;
+		frame_size(width, height);
+		const double step = pixel_step(width, height);
+		centre_x_ += pan_x * step;
+		centre_y_ -= pan_y * step;
+		pan_x_ -= pan_x;
+		pan_y_ -= pan_y;
+		pan_pending_ = true;
+	}
+	// Wait for the frame being calculated - cancelling it would throw away the counts the pan reuses
+	// (render() shows the last frame moved in the meantime).
+	if (pan_pending_ && !renderer_.busy() && !timing_)
+	{
+		pan_pending_ = false;
+		calculate_ = true;
 	}
-	// use software adapter accelerator with current Mandelbrot
-	if (input->isKeyDown('3'))
+	// use backend 1-4 (the C++ AMP accelerators come first) with current Mandelbrot
+	for (char key = '1'; key <= '4'; ++key)
 	{
-		// set current accelerator to software adapter
-		current_accelerator_ = 2;
-		// depending on the current Mandelbrot method being used put timing results into separate files
-		switch (calc_mandelbrot_)
+		if (input->isKeyDown(key))
 		{
-		case AMP_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			if (accls_[current_accelerator_] == accelerator(accelerator::direct3d_ref))
-				std::cout << " WARNING!! Running on very slow emulator! Only use this accelerator for debugging." << std::endl;
-			file_amp_mandelbrot_software_adapter_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_PIXEL_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			if (accls_[current_accelerator_] == accelerator(accelerator::direct3d_ref))
-				std::cout << " WARNING!! Running on very slow emulator! Only use this accelerator for debugging." << std::endl;
-			file_amp_pixel_mandelbrot_software_adapter_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_BARRIER_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			if (accls_[current_accelerator_] == accelerator(accelerator::direct3d_ref))
-				std::cout << " WARNING!! Running on very slow emulator! Only use this accelerator for debugging." << std::endl;
-			file_amp_barrier_mandelbrot_software_adapter_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_barrier_mandelbrot_software_adapter_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
+			BackendRegistry& backends = BackendRegistry::instance();
+			unsigned i = key - '1';
+			if (i < backends.size()) { use_backend(&backends[i]); }
+			input->SetKeyUp(key);
 		}
-		input->SetKeyUp('3');
 	}
-	// use cpu accelerator with current Mandelbrot
-	if (input->isKeyDown('4'))
+	// cycle through all the backends
+	if (input->isKeyDown(']'))
 	{
-		// set current accelerator to cpu accelerator
-		current_accelerator_ = 3;
-		// depending on the current Mandelbrot method being used put timing results into separate files
-		switch (calc_mandelbrot_)
-		{
-		case AMP_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_mandelbrot_cpu_accelerator_ << "amp_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_PIXEL_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_pixel_mandelbrot_cpu_accelerator_ << "amp_pixel_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_pixel_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		case AMP_BARRIER_MANDELBROT:
-			std::wcout << "Using acc " << current_accelerator_ + 1 << " = " << accls_[current_accelerator_].description << endl;
-			file_amp_barrier_mandelbrot_cpu_accelerator_ << "amp_barrier_mandelbrot using " << ws2s(accls_[current_accelerator_].description) << endl;
-			file_amp_barrier_mandelbrot_cpu_accelerator_ << "TILE_SIZE " << TILE_SIZE << endl;
-			break;
-		}
-		input->SetKeyUp('4');
+		BackendRegistry& backends = BackendRegistry::instance();
+		if (backends.size() > 0) { use_backend(&backends[(backends.index_of(backend_) + 1) % backends.size()]); }
+		input->SetKeyUp(']');
 	}
 	// switch to amp_mandelbrot Mandelbrot calculation method
 	if (input->isKeyDown('5'))
 	{
-		calc_mandelbrot_ = AMP_MANDELBROT;
-		cout << "\nDisplaying amp_madelbrot set\n" << endl;
+		use_method(AMP_MANDELBROT);
 		input->SetKeyUp('5');
 	}
 	// switch to amp_pixel_mandelbrot Mandelbrot calculation method
 	if (input->isKeyDown('6'))
 	{
-		calc_mandelbrot_ = AMP_PIXEL_MANDELBROT;
-		cout << "\nDisplaying amp_pixel_madelbrot set\n" << endl;
+		use_method(AMP_PIXEL_MANDELBROT);
 		input->SetKeyUp('6');
 	}
 	// switch to amp_barrier_mandelbrot Mandelbrot calculation method
 	if (input->isKeyDown('7'))
 	{
-		calc_mandelbrot_ = AMP_BARRIER_MANDELBROT;
-		cout << "\nDisplaying amp_barrier_madelbrot set\n" << endl;
+		use_method(AMP_BARRIER_MANDELBROT);
 		input->SetKeyUp('7');
 	}
-	// after 'c' was pressed keep calculating the Mandelbrot set until i_ reaches the maximum amount of timigns (max_timings_)
-	if (i_ == max_timings_)
+	// switch to cpu_mandelbrot Mandelbrot calculation method
+	if (input->isKeyDown('8'))
 	{
-		timing_ = false;
-		i_ = 0;
-		//exit(0);
+		use_method(CPU_MANDELBROT);
+		input->SetKeyUp('8');
 	}
-	// calculate the Mandelbrot set only when the function was called
-	if (calculate_ || timing_)
+	// the thread count, kernel and schedule keys change the engine of the current CPU backend
+	// the changes are made on the compute thread between two frames
+	CpuBackend * cpu_backend = dynamic_cast<CpuBackend *>(backend_);
+	// add a worker thread to the cpu_mandelbrot engine
+	if (input->isKeyDown('+') ||
+		input->isKeyDown('='))
 	{
-		// <------------------------------------------------------------- start timing
-		auto start_timing = std::async(std::launch::async, [=]()
+		if (cpu_backend)
 		{
-			if (accls_[current_accelerator_] == accelerator(accelerator::direct3d_ref))
-				cout << "Calculating Mandelbrot..." << endl; 
-			// Start timing
-			the_clock::time_point start = the_clock::now();
-			return start;
-		});
-
-		switch (calc_mandelbrot_)
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_thread_count(engine.thread_count() + 1);
+				cout << "cpu_mandelbrot threads: " << engine.thread_count() << endl;
+			});
+		}
+		input->SetKeyUp('+');
+		input->SetKeyUp('=');
+	}
+	// remove a worker thread from the cpu_mandelbrot engine (can't go lower than 1)
+	if (input->isKeyDown('-'))
+	{
+		if (cpu_backend)
 		{
-		case AMP_MANDELBROT :
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				if (engine.thread_count() > 1) { engine.set_thread_count(engine.thread_count() - 1); }
+				cout << "cpu_mandelbrot threads: " << engine.thread_count() << endl;
+			});
+		}
+		input->SetKeyUp('-');
+	}
+	// cycle through the cpu_mandelbrot escape-time kernels (scalar, SSE2, AVX2, AVX-512) supported by this CPU
+	if (input->isKeyDown('9'))
+	{
+		if (cpu_backend)
 		{
-		// This shows the whole set.
-			//cpu_mandelbrot(-2.0, 1.0, 1.125, -1.125); // 31630, 27280, 27083 [ms]
-			amp_mandelbrot(-2.0, 1.0, 1.125, -1.125); // 59, 112, 110, 64 [ms]
-		} break;
-		case AMP_PIXEL_MANDELBROT:
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				KERNEL_ISA isa = (KERNEL_ISA)(engine.isa() + 1);
+				engine.set_isa(isa);
+				if (engine.isa() != isa) { engine.set_isa(ISA_SCALAR); }
+				cout << "cpu_mandelbrot kernel: " << isa_name(engine.isa()) << endl;
+			});
+		}
+		input->SetKeyUp('9');
+	}
+	// switch the cpu_mandelbrot escape-time kernels between double precision and the faster float ones
+	if (input->isKeyDown('e') ||
+		input->isKeyDown('E'))
+	{
+		if (cpu_backend)
 		{
-			// This shows the whole set.
-			amp_pixel_mandelbrot(-2.0, 1.0, 1.125, -1.125); // 59, 112, 110, 64 [ms]
-		} break;
-		case AMP_BARRIER_MANDELBROT :
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_precision(engine.precision() == PRECISION_DOUBLE ? PRECISION_FLOAT : PRECISION_DOUBLE);
+				cout << "cpu_mandelbrot precision: " << precision_name(engine.precision()) << endl;
+			});
+		}
+		input->SetKeyUp('e');
+		input->SetKeyUp('E');
+	}
+	// switch the cpu_mandelbrot engine between the static split and work stealing
+	if (input->isKeyDown('0'))
+	{
+		if (cpu_backend)
 		{
-		// This shows the whole set.
-			amp_barrier_mandelbrot(-2.0, 1.0, 1.125, -1.125); // 59, 112, 110, 64 [ms]
-		} break;
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_schedule(engine.schedule() == SCHEDULE_STATIC ? SCHEDULE_WORK_STEALING : SCHEDULE_STATIC);
+				cout << "cpu_mandelbrot schedule: " << schedule_name(engine.schedule()) << endl;
+			});
 		}
-		// <---------------------------------------------------------end timing
-		auto end_timing = std::async(std::launch::async, [=, &start_timing]()
+		input->SetKeyUp('0');
+	}
+	// switch the interior checks (cardioid and bulb test, cycle detection) of the cpu_mandelbrot engine on or off
+	if (input->isKeyDown('j') ||
+		input->isKeyDown('J'))
+	{
+		if (cpu_backend)
 		{
-			the_clock::time_point start = start_timing.get();
-			the_clock::time_point end = the_clock::now();
-			// Compute the difference between the two times in milliseconds
-			auto time_taken = duration_cast<milliseconds>(end - start).count();
-			
-			// put timings into files depending on the current Mandelbot set calculation mathod and accelerator
-			if (timing_) 
+			renderer_.post([cpu_backend]()
 			{
-				switch (calc_mandelbrot_)
-				{
-				case AMP_MANDELBROT:
-				{
-					switch (current_accelerator_) {
-					case NVIDIA: {
-						file_amp_mandelbrot_nvidia_ << time_taken << endl;
-					} break;
-					case MICROSOFT_BASIC_RENDER_DRIVER: {
-						file_amp_mandelbrot_msc_basic_render_driver_ << time_taken << endl;
-					} break;
-					case SOFTWARE_ADAPTER: {
-						file_amp_mandelbrot_software_adapter_ << time_taken << endl;
-					} break;
-					case CPU_ACCELERATOR: {
-						file_amp_mandelbrot_cpu_accelerator_ << time_taken << endl;
-					} break;
-					}
-					std::cout << i_ << "\n";
-				} break;
-				case AMP_PIXEL_MANDELBROT:
-				{
-					switch (current_accelerator_) {
-					case NVIDIA: {
-						file_amp_pixel_mandelbrot_nvidia_ << time_taken << endl;
-					} break;
-					case MICROSOFT_BASIC_RENDER_DRIVER: {
-						file_amp_pixel_mandelbrot_msc_basic_render_driver_ << time_taken << endl;
-					} break;
-					case SOFTWARE_ADAPTER: {
-						file_amp_pixel_mandelbrot_software_adapter_ << time_taken << endl;
-					} break;
-					case CPU_ACCELERATOR: {
-						file_amp_pixel_mandelbrot_cpu_accelerator_ << time_taken << endl;
-					} break;
-					}
-					std::cout << i_ << "\n";
-				} break;
-				case AMP_BARRIER_MANDELBROT:
-				{
-					switch (current_accelerator_) {
-					case NVIDIA: {
-						file_amp_barrier_mandelbrot_nvidia_ << time_taken << endl;
-					} break;
-					case MICROSOFT_BASIC_RENDER_DRIVER: {
-						file_amp_barrier_mandelbrot_msc_basic_render_driver_ << time_taken << endl;
-					} break;
-					case SOFTWARE_ADAPTER: {
-						file_amp_barrier_mandelbrot_software_adapter_ << time_taken << endl;
-					} break;
-					case CPU_ACCELERATOR: {
-						file_amp_barrier_mandelbrot_cpu_accelerator_ << time_taken << endl;
-					} break;
-					}
-					std::cout << i_ << "\n";
-				} break;
-				}
-			} // display single timings
-			else 
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_interior_checks(!engine.interior_checks());
+				cout << "cpu_mandelbrot interior checks: " << (engine.interior_checks() ? "on" : "off") << endl;
+			});
+		}
+		input->SetKeyUp('j');
+		input->SetKeyUp('J');
+	}
+	// cycle through the ways the cpu_mandelbrot engine calculates a frame (tiles, subdivision, boundary tracing, refinement, slices)
+	if (input->isKeyDown('m') ||
+		input->isKeyDown('M'))
+	{
+		if (cpu_backend)
+		{
+			renderer_.post([cpu_backend]()
 			{
-				std::wcout << "Computing Mandelbrot using " << accls_[current_accelerator_].description
-						   << " took " << time_taken << " ms." << endl;
-			}
-		});
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_mode((RENDER_MODE)((engine.mode() + 1) % RENDER_MODE_COUNT));
+				cout << "cpu_mandelbrot mode: " << mode_name(engine.mode()) << endl;
+			});
+		}
+		input->SetKeyUp('m');
+		input->SetKeyUp('M');
+	}
+	// switch the check of the points inside uniform rectangles of the subdivide mode on or off
+	if (input->isKeyDown('n') ||
+		input->isKeyDown('N'))
+	{
+		if (cpu_backend)
+		{
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_verify_fills(!engine.verify_fills());
+				cout << "cpu_mandelbrot subdivide and boundary fill checks: " << (engine.verify_fills() ? "on" : "off") << endl;
+			});
+		}
+		input->SetKeyUp('n');
+		input->SetKeyUp('N');
+	}
+	// switch the guessing of the refine mode on or off
+	if (input->isKeyDown('y') ||
+		input->isKeyDown('Y'))
+	{
+		if (cpu_backend)
+		{
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_refine_guess(!engine.refine_guess());
+				cout << "cpu_mandelbrot refine guessing: " << (engine.refine_guess() ? "on" : "off") << endl;
+			});
+		}
+		input->SetKeyUp('y');
+		input->SetKeyUp('Y');
+	}
+	// cycle the order the tiles are calculated in - nearest to the centre first, nearest to the cursor first, row by row
+	if (input->isKeyDown('f') ||
+		input->isKeyDown('F'))
+	{
+		if (!focus_first_)
+		{
+			focus_first_ = true;
+			focus_cursor_ = false;
+		}
+		else if (!focus_cursor_)
+		{
+			focus_cursor_ = true;
+		}
+		else
+		{
+			focus_first_ = false;
+		}
+		cout << "tile order: " << (!focus_first_ ? "row by row" : focus_cursor_ ? "cursor first" : "centre first") << endl;
+		input->SetKeyUp('f');
+		input->SetKeyUp('F');
+	}
+	// switch the tile cache of the cpu_mandelbrot engine on or off
+	if (input->isKeyDown('t') ||
+		input->isKeyDown('T'))
+	{
+		if (cpu_backend)
+		{
+			renderer_.post([cpu_backend]()
+			{
+				CpuEngine& engine = cpu_backend->engine();
+				engine.set_tile_cache(!engine.tile_cache_enabled());
+				cout << "cpu_mandelbrot tile cache: " << (engine.tile_cache_enabled() ? "on" : "off") << endl;
+			});
+		}
+		input->SetKeyUp('t');
+		input->SetKeyUp('T');
+	}
+	// the frame follows the size of the window - recalculate it once the window was resized
+	if (requested_width_ != 0 && !timing_)
+	{
+		unsigned width, height;
+		frame_size(width, height);
+		if (width != requested_width_ || height != requested_height_) { calculate_ = true; }
+	}
+	// calculate the Mandelbrot set only when the function was called
+	// after 'c' was pressed the compute thread calculates it max_timings_ times
+	if (calculate_ || timing_ || recolour_)
+	{
+		// only the colours changed - colour the stored escape counts again (unless they belong to an older view)
+		calculate(!calculate_ && !timing_ && !pan_pending_); // 59, 112, 110, 64 [ms]
 	}
 	// update the camera
-	camera->cameraControll(dt, WIDTH, HEIGHT, input);
+	camera->cameraControll(dt, glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT), input);
 	camera->update();
 }
 
@@ -1048,103 +701,64 @@ void Mandelbrot::render()
 	gluLookAt(camera->getPositionX(), camera->getPositionY(), camera->getPositionZ(),
 		camera->getLookAtX(), camera->getLookAtY(), camera->getLookAtZ(),
 		camera->getUpX(), camera->getUpY(), camera->getUpZ());
-	
-	switch (calc_mandelbrot_)
-	{
-	case AMP_MANDELBROT :
-	{
-		glPushMatrix(); {
-			// Scale
-			glScalef(scale_.x, scale_.y, scale_.z);
-			// Translate
-			glTranslatef(translate_.x, translate_.y, translate_.z);
-			// render Mandelbrot
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-			glVertexPointer(3, GL_FLOAT, 0, quad_t_verts.data());
-			glTexCoordPointer(2, GL_FLOAT, 0, quad_t_texcoords.data());
-
-			glGenTextures(1, &amp_mandelbrot_texture_);
-			glBindTexture(GL_TEXTURE_2D, amp_mandelbrot_texture_);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexImage2D(GL_TEXTURE_2D, 0, 3, WIDTH, HEIGHT,
-				0, GL_BGR_EXT, GL_UNSIGNED_BYTE, pixel_amp_mandelbrot_.data()); // <----- had to use GL_BGR_EXT
-
-			//glColor4f(_rgba.getR(), _rgba.getG(), _rgba.getB(), _rgba.getA());
-			glDrawArrays(GL_TRIANGLES, 0, quad_t_verts.size() / 3);
-			//glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-			glBindTexture(GL_TEXTURE_2D, NULL);
-
-			glDisableClientState(GL_VERTEX_ARRAY);
-			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		} glPopMatrix();
-	} break;
-
-	case AMP_PIXEL_MANDELBROT:
+	// draw the newest frame finished by the compute thread (the next one may still be calculated)
+	const DisplayFrame * frame = renderer_.acquire();
+	if (frame == nullptr) { return; }
+	// one texture per calculation method, only updated when a new frame was finished
+	TextureStream * texture = &amp_mandelbrot_texture_;
+	const void * pixels = frame->pixels.data();
+	switch (frame->method)
 	{
-		glPushMatrix(); {
-			// Scale
-			glScalef(scale_.x, scale_.y, scale_.z);
-			// Translate
-			glTranslatef(translate_.x, translate_.y, translate_.z);
-			// render Mandelbrot
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-			glVertexPointer(3, GL_FLOAT, 0, quad_t_verts.data());
-			glTexCoordPointer(2, GL_FLOAT, 0, quad_t_texcoords.data());
-
-			glGenTextures(1, &amp_barrier_mandelbrot_texture_);
-			glBindTexture(GL_TEXTURE_2D, amp_barrier_mandelbrot_texture_);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexImage2D(GL_TEXTURE_2D, 0, 3, WIDTH, HEIGHT,
-				0, GL_BGR_EXT, GL_INT, pixel_amp_pixel_mandlebrot_.data()); // <----- had to use GL_INT
-
-			glDrawArrays(GL_TRIANGLES, 0, quad_t_verts.size() / 3);
-			glBindTexture(GL_TEXTURE_2D, NULL);
-
-			glDisableClientState(GL_VERTEX_ARRAY);
-			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		} glPopMatrix();
-	} break;
-
+	case AMP_MANDELBROT :
+	case CPU_MANDELBROT :
+		texture = &amp_mandelbrot_texture_;
+		break;
+	case AMP_PIXEL_MANDELBROT :
+		texture = &amp_pixel_mandelbrot_texture_;
+		break;
 	case AMP_BARRIER_MANDELBROT :
+		texture = &amp_barrier_mandelbrot_texture_;
+		break;
+	}
+	if (texture->update(frame->generation, frame->width, frame->height, pixels))
 	{
-		glPushMatrix(); {
-			// Scale
-			glScalef(scale_.x, scale_.y, scale_.z);
-			// Translate
-			glTranslatef(translate_.x, translate_.y, translate_.z);
-			// render Mandelbrot
-			glEnableClientState(GL_VERTEX_ARRAY);
-			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-
-			glVertexPointer(3, GL_FLOAT, 0, quad_t_verts.data());
-			glTexCoordPointer(2, GL_FLOAT, 0, quad_t_texcoords.data());
-
-			glGenTextures(1, &amp_pixel_mandelbrot_texture_);
-			glBindTexture(GL_TEXTURE_2D, amp_pixel_mandelbrot_texture_);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexImage2D(GL_TEXTURE_2D, 0, 3, WIDTH, HEIGHT,
-				0, GL_BGR_EXT, GL_INT, pixel_amp_barrier_mandelbrot_.data()); // <----- had to use GL_INT
-
-			glDrawArrays(GL_TRIANGLES, 0, quad_t_verts.size() / 3);
-			glBindTexture(GL_TEXTURE_2D, NULL);
-
-			glDisableClientState(GL_VERTEX_ARRAY);
-			glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-		} glPopMatrix();
-	} break;
+		renderer_.frame_uploaded(texture->upload_ms());
 	}
-}
\ No newline at end of file
+
+	// Until the frame of the current view is finished, the last one is reprojected onto it:
+	// the texture coordinates of the quad are mapped from the view to the region of the frame.
+	double left, right, top, bottom;
+	view_region(frame->width, frame->height, left, right, top, bottom);
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glTranslated((left - frame->left) / (frame->right - frame->left), (top - frame->top) / (frame->bottom - frame->top), 0.0);
+	glScaled((right - left) / (frame->right - frame->left), (bottom - top) / (frame->bottom - frame->top), 1.0);
+	glMatrixMode(GL_MODELVIEW);
+
+	glPushMatrix(); {
+		// Scale (the quad is as wide as the frame relative to its height)
+		glScalef(scale_.x * float(frame->width) / float(frame->height), scale_.y, scale_.z);
+		// Translate
+		glTranslatef(translate_.x, translate_.y, translate_.z);
+		// render Mandelbrot
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+
+		glVertexPointer(3, GL_FLOAT, 0, quad_t_verts.data());
+		glTexCoordPointer(2, GL_FLOAT, 0, quad_t_texcoords.data());
+
+		glBindTexture(GL_TEXTURE_2D, texture->texture());
+		//glColor4f(_rgba.getR(), _rgba.getG(), _rgba.getB(), _rgba.getA());
+		glDrawArrays(GL_TRIANGLES, 0, quad_t_verts.size() / 3);
+		//glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glDisableClientState(GL_VERTEX_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	} glPopMatrix();
+
+	glMatrixMode(GL_TEXTURE);
+	glLoadIdentity();
+	glMatrixMode(GL_MODELVIEW);
+}
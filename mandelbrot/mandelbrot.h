@@ -1,45 +1,24 @@
-#pragma once
+﻿#pragma once
 #include <freeglut.h>
 #include <fstream>
 #include <complex.h>
 #include <future>
 #include <thread>
-#include <amp.h>
-#include <iomanip>
-#include <codecvt>
 #include "dependencies.h"
 #include "quad.h"
-#include "input.h"
+#include "Input.h"
 #include "Camera.h"
 #include "FreeCamera.h"
-
-#define TILE_SIZE 8
-// The size of the image to generate.
-#define WIDTH 2048  
-#define HEIGHT 2048
-#define DATA_SIZE (HEIGHT * WIDTH)
-
-using namespace concurrency;
-
-enum CALC_MANDELBROT
-{
-	AMP_MANDELBROT,
-	AMP_PIXEL_MANDELBROT,
-	AMP_BARRIER_MANDELBROT,
-};
-
-enum
-{
-	NVIDIA,
-	MICROSOFT_BASIC_RENDER_DRIVER,
-	SOFTWARE_ADAPTER,
-	CPU_ACCELERATOR
-};
+#include "Frame.h"
+#include "Backend.h"
+#include "FrameRenderer.h"
+#include "TextureStream.h"
 
 class Mandelbrot
 {
 public:
-	Mandelbrot(Input * in);
+	// frame_width x frame_height - size of the calculated image (0 x 0 follows the size of the window)
+	Mandelbrot(Input * in, unsigned frame_width = 0, unsigned frame_height = 0, float escape_radius = 2.0f);
 	~Mandelbrot();
 	// Mandlebrot OpenGL function calls
 	void update(float dt);
@@ -54,63 +33,66 @@ private:
 	// displaying texture variables
 	Vector3 scale_;
 	Vector3 translate_;
-	Vector3 zoom_;
-	float zoom_scale_;
 	// enum to call specific Mandelbrot funstions
 	CALC_MANDELBROT calc_mandelbrot_;
-	// accelerators variables
-	std::vector<accelerator> accls_;
-	uint8_t current_accelerator_;
+	// backend (C++ AMP accelerator, CPU engine, ...) calculating the Mandelbrot set
+	Backend * backend_;
+	// select a backend from the BackendRegistry
+	void use_backend(Backend * backend);
+	// select a calculation method (switches to the first backend able to run it if the current one can't)
+	void use_method(CALC_MANDELBROT method);
 	// variables passed to lambda functions of Mandelbrot calcualtion functions
 	unsigned long max_iterations_; // The number of times to iterate before we assume that a point isn't in the Mandelbrot set.
 	unsigned b_, g_, r_;           // blue, green and red colours
-	// Different methods of calculating mandelbrot
-	void cpu_mandelbrot(float left, float right, float top, float bottom);
-	void amp_mandelbrot(float left, float right, float top, float bottom);
-	void amp_pixel_mandelbrot(float left, float right, float top, float bottom);
-	void amp_barrier_mandelbrot(float left, float right, float top, float bottom);
-	// amp_mandelbrot
-	std::array<uint32_t, DATA_SIZE> image_amp_mandelbrot_;
-	std::vector<uint8_t> pixel_amp_mandelbrot_;
-	// amp_pixel_mandelbrot
-	std::array<uint32_t, DATA_SIZE> image_amp_pixel_mandlebrot_;
-	std::array<int, DATA_SIZE * 3> pixel_amp_pixel_mandlebrot_;
-	// amp_barrier_mandelbrot
-	std::array<uint32_t, DATA_SIZE> image_amp_barrier_mandelbrot_;
-	std::vector<int> pixel_amp_barrier_mandelbrot_;
+	unsigned palette_offset_;      // palette cycling
+	float escape_radius_;          // a point escaped once |z| reached it
+	// size of the calculated image (0 x 0 - the size of the window)
+	unsigned frame_width_, frame_height_;
+	// size of the last frame asked for (a new window size recalculates it)
+	unsigned requested_width_, requested_height_;
+	// size of the next frame
+	void frame_size(unsigned& width, unsigned& height) const;
+	// view on the complex plane - its centre and the size of the region that has to fit in the frame
+	double centre_x_, centre_y_;
+	double view_width_, view_height_;
+	// show the whole set again
+	void reset_view();
+	// size of a frame pixel on the complex plane
+	double pixel_step(unsigned width, unsigned height) const;
+	// region of the complex plane a width x height frame of the view shows
+	void view_region(unsigned width, unsigned height, double& left, double& right, double& top, double& bottom) const;
+	// zoom the view by factor (< 1 zooms in) keeping the point under the mouse where it is
+	void zoom_at(int mouse_x, int mouse_y, double factor);
+	// dragging with the left mouse button pans the view
+	bool dragging_;
+	int drag_x_, drag_y_;       // mouse position the last update
+	float pan_x_, pan_y_;       // frame pixels dragged but not panned yet
+	bool pan_pending_;          // the view was panned while a frame was being calculated
+	// the view was zoomed - the next frame is calculated progressively
+	bool zoomed_;
+	// the tiles nearest to the pixel the user looks at are calculated first - the centre of the frame,
+	// or the pixel under the cursor when focus_cursor_ is set
+	bool focus_first_;
+	bool focus_cursor_;
+	// calculates the Mandelbrot set on the compute thread
+	FrameRenderer renderer_;
+	// ask the compute thread to calculate the Mandelbrot set with the current backend and method
+	// The view is widened to the aspect ratio of the frame.
+	void calculate(bool recolour);
 	// maximum timing
 	int max_timings_;
-	// current number of timings
-	int i_;
 	// 
 	bool timing_;
 	// 
 	bool calculate_;
+	// only the colours changed
+	bool recolour_;
 	// textures variables
-	GLenum texture_;
-	GLenum amp_mandelbrot_texture_;
-	GLenum amp_pixel_mandelbrot_texture_;
-	GLenum amp_barrier_mandelbrot_texture_;
+	TextureStream amp_mandelbrot_texture_;
+	TextureStream amp_pixel_mandelbrot_texture_;
+	TextureStream amp_barrier_mandelbrot_texture_;
 	// flag for calling once a lambda function in update()
 	std::once_flag flag_;
-	std::once_flag accls_amp_mandelbrot_flag;
-	std::once_flag accls_pixel_mandelbrot_flag;
-	std::once_flag accls_barrier_mandelbrot_flag;
-	// file to store timings
-	std::ofstream file_amp_mandelbrot_nvidia_;
-	std::ofstream file_amp_mandelbrot_msc_basic_render_driver_;
-	std::ofstream file_amp_mandelbrot_software_adapter_;
-	std::ofstream file_amp_mandelbrot_cpu_accelerator_;
-	std::ofstream file_amp_pixel_mandelbrot_nvidia_;
-	std::ofstream file_amp_pixel_mandelbrot_msc_basic_render_driver_;
-	std::ofstream file_amp_pixel_mandelbrot_software_adapter_;
-	std::ofstream file_amp_pixel_mandelbrot_cpu_accelerator_;
-	std::ofstream file_amp_barrier_mandelbrot_nvidia_;
-	std::ofstream file_amp_barrier_mandelbrot_msc_basic_render_driver_;
-	std::ofstream file_amp_barrier_mandelbrot_software_adapter_;
-	std::ofstream file_amp_barrier_mandelbrot_cpu_accelerator_;
-	// convert std::wstring into std::string
-	std::string ws2s(const std::wstring& wstr);
 };
 
 